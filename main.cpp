@@ -7,6 +7,8 @@
 #include "source/MotorControl.h"
 #include "source/EventVariable.h"
 #include "source/MovingAverage.h"
+#include "source/CalibrationStore.h"
+#include "source/ControllerBenchmark.h"
 
 // set baudrate at mbed_config.h default 115200
 // I2C scanner included, derived from Arduino I2C scanner
@@ -17,6 +19,15 @@ volatile bool prevMotorSteady = false;		// Store previous motor steady state
 //volatile float currentSpeed;
 float refSpeedFloat;
 const float motor1RPM = 24.0f/50.0f;
+const float speedSamplingRate = 10;     // speed estimation rate (Hz)
+const float speedFilterCutoff = 0;      // speed low-pass cutoff (Hz), 0 to disable
+const float controlRate = 0;            // PID execution rate (Hz, max 1000, PulseCount: max speedSamplingRate), 0 to run at every speed sample
+const float pwmFrequency = 10000;       // motor PWM frequency (Hz), 10000 duty steps on PA_15 (TIM2 at 100 MHz)
+const float travelPerRotation = 0;      // carriage travel per output shaft rotation (mm), 0 if not calibrated
+const float seamLength = 0;             // weld this length (mm) per motor start and stop on target, 0 to run until stopped
+const bool identifyModel = true;        // estimate motor model online, reported in status
+const bool calibrateDuty = false;       // sweep duty at start (carriage moves up to full speed) and save to flash
+const bool benchmarkControllers = false;    // print CPU cycles per PID step of every controller and per coordinator pass at start
 
 /////////////////////////////////
 //// Declare connection//////////
@@ -46,11 +57,13 @@ DigitalOut MotorDirectionPin2(MotorDirection2);
 
 //// Initiate object
 RawSerial pc(SERIAL_TX, SERIAL_RX, 115200);		                // serial communication protocol
-std::shared_ptr<EncodedMotor> encoder = std::make_shared<EncodedMotor>(MotorEncoderA, MotorEncoderB, 1848*4*50, 10, EncodeType::X4);		// Encoded Motor object
+std::shared_ptr<EncodedMotor> encoder = std::make_shared<EncodedMotor>(MotorEncoderA, MotorEncoderB, 1848*4*50, speedSamplingRate, EncodeType::X4,
+        EncoderBackend::Interrupt, SpeedEstimator::Hybrid);		// Encoded Motor object, EncoderBackend::Timer to count with TIM1 (PulseCount only)
 std::unique_ptr<MotorControl> motor1 = std::make_unique<MotorControl>
-        (MotorEnable, MotorDirection1, MotorDirection2, encoder, 0.20, 0.005, 0.08, motor1RPM);		// motor controller object, Kp, Ki, Kd specified
+        (MotorEnable, MotorDirection1, MotorDirection2, encoder, 0.20, 2.0, 0.08, motor1RPM, pwmFrequency);		// motor controller object, Kp, Ki, Kd specified (positional form)
 DebugMonitor debugger(&refSpeed, encoder, &pc);		        	// update status through LCD2004 and Serial Monitor
 ShiftReg7Seg disp1(SPI_MOSI, SPI_MISO, SPI_SCK, SPI_CS, 4, D9); // 7 segments display
+CalibrationStore calibrationStore;                              // duty calibration in last flash sector
 
 //// Declare interrupt
 Ticker statusUpdater;			// Periodic Interrupt for debugging purpose
@@ -69,6 +82,7 @@ Thread dispThread;              // Thread to display 7 segments display
 //// Declare event flag
 EventFlags statusUpdateFlag;
 EventFlags interuptRestartFlag;
+EventFlags controlFlag;             // set at every control tick
 
 //// Fwd declare
 void I2C_scan();
@@ -78,6 +92,7 @@ void motorRunner();
 void MotorLEDBlinker(bool&);
 void restartMotorButton();
 void restartTorchButton();
+void motorFaultEvent();
 
 // Initiate EventVariable
 EventVariable<bool> motorStartBtnChange(false, &motorStartBtnChangeEvent);
@@ -143,6 +158,14 @@ void statusUpdateEvent()
                   refSpeedFloat*100, motor1->readComp(), motor1->readSpeed(), motor1->readError(), motor1->readAdjError(),
                   motor1->getCurrentDirection());
         pc.printf( "Steady Count: %d\n",  motor1->getSteadyCount());
+        pc.printf( "Duty: %.2f (resolution %.2f)\n",  motor1->readDuty(), motor1->getDutyResolution());
+        pc.printf( "Encoder Invalid Transitions: %lu\n",  encoder->getInvalidTransitions());
+        if (travelPerRotation > 0) pc.printf( "Position: %.1f mm\n",  encoder->getPositionMillimetres());
+        pc.printf( "Encoder ISR Cycles: %lu\n",  (unsigned long)encoder->getSaveDataCycles());
+        pc.printf( "CPU Idle: %.1f%%\n",  debugger.readIdlePercent());
+        ModelIdentifier::Model model = motor1->readModel();
+        if (model.valid) pc.printf("Model Gain: %f\n Time Constant: %f s\n Delay: %f s\n Deadband: %f\n",
+                                   model.gain, model.timeConstant, model.delay, model.deadband);
     }
 }
 void motorStartBtnChangeEvent(bool &motorState) {
@@ -153,7 +176,9 @@ void motorStartBtnChangeEvent(bool &motorState) {
 		motor1->setRefVolt(0);
 	}
 	else {
-		motor1->setRefVolt(refSpeedFloat);
+		motor1->clearFault();
+		if (seamLength > 0) motor1->startMove(seamLength, refSpeedFloat);
+		else motor1->setRefVolt(refSpeedFloat);
 		motorSteadySignal = false; //this will trigger LED blinker to activate
 	}
 
@@ -180,6 +205,11 @@ void motorRunner()
     bool tempMotorSteady = motor1->run();			// run motor1 and read motor1 steady state
 	if (tempMotorSteady != prevMotorSteady) motorSteadySignal = tempMotorSteady;
 	prevMotorSteady = tempMotorSteady;
+	// seam completed, turn off torch and motor
+	if (seamLength > 0 && !motor1->isMoving()) {
+		weldSignal = false;
+		motorStartBtnChange = false;
+	}
 }
 void motorStopper()
 {
@@ -204,6 +234,12 @@ void displayCurrentSpeed(){
         wait(0.1);
     }
 }
+void motorFaultEvent() {
+	// motor stopped by stall detection, turn off torch and wait for restart from motor button
+	weldSignal = false;
+	motorStartBtnChange = false;
+	pc.printf("Motor fault: %d\n", (int)motor1->getFault());
+}
 void restartMotorButton() {motorBtn.enable_irq(); buttonRestart.detach(); }
 void restartTorchButton() {weldingBtn.enable_irq(); torchButtonRestart.detach(); }
 int main() {
@@ -217,11 +253,18 @@ int main() {
 	    prevMotorSteady = false;
 	    motorStartBtnChange = !motorStartBtnChange; });				// motorBtn OnChange
 	weldingBtn.rise([&]() {
-		//bool toSolenoid = motorStartBtnChange.value && !weldSignal  && motorSteadySignal.value;   //temp change - disable check steady
-        bool toSolenoid = motorStartBtnChange.value && !weldSignal;
+		bool toSolenoid = motorStartBtnChange.value && !weldSignal && motorSteadySignal.value;   // torch only at steady speed
 		toSolenoid ? weldSignal = true : weldSignal = false; });					// weldingBtn OnChange
     motorChgDirBtn.rise([](){motor1->chgDirection(); });
 	statusUpdater.attach([](){statusUpdateFlag.set(0x1); }, 0.5f);					// periodic status update via flag
+	encoder->setSpeedFilter(speedFilterCutoff);
+	motor1->setControlRate(controlRate);
+	motor1->setIdentification(identifyModel);
+	motor1->setReversal(MotorControl::ReversalMode::Resume);		// direction button reverses and ramps back to speed
+	motor1->attachFaultCallback(&motorFaultEvent);						// stop welding if carriage jams
+	motor1->setTravelPerRotation(travelPerRotation);
+	motor1->attachControlCallback([](){controlFlag.set(0x1); });				// wake control loop on every control tick
+	debugger.startIdleMonitor();
 
     // Start Thread
 	dispThread.start(displayCurrentSpeed);			// 7-segment Thread Start
@@ -230,9 +273,36 @@ int main() {
     // Initialize Output
     TorchLED = 0; 								// Initialize TorchLED
 
+    // Duty linearisation, calibrate once or use stored calibration
+    MotorControl::LinearisationTable dutyTable;
+    if (calibrateDuty) {
+        pc.printf("Calibrating duty\n");
+        motor1->startCalibration();
+        while (motor1->isCalibrating()) {
+            controlFlag.wait_any(0x1);
+            motor1->run();
+        }
+        if (!motor1->readLinearisation().empty() && calibrationStore.save(motor1->readLinearisation()))
+            pc.printf("Duty calibration saved\n");
+    }
+    else if (calibrationStore.load(dutyTable)) motor1->setLinearisation(dutyTable);
+
+	if (benchmarkControllers) {
+	    ControllerCycles cycles = measureControllerCycles();
+	    pc.printf("PID step cycles: PIDcontrol %lu, DiscretePID float %lu / %lu, Q16.16 %lu / %lu (nominal / irregular)\n",
+	              (unsigned long)cycles.pidControl, (unsigned long)cycles.discreteFloat,
+	              (unsigned long)cycles.discreteFloatIrregular, (unsigned long)cycles.discreteFixed,
+	              (unsigned long)cycles.discreteFixedIrregular);
+	    CoordinatorCycles passCycles = measureCoordinatorCycles();
+	    pc.printf("Coordinator pass cycles: 1 axis %lu, 2 axes %lu, 3 axes %lu\n", (unsigned long)passCycles.pass[0],
+	              (unsigned long)passCycles.pass[1], (unsigned long)passCycles.pass[2]);
+	}
+
 	pc.printf("Ready\n");
 
+	// control loop, sleep until encoder publishes new speed sample
 	while (1) {
+		controlFlag.wait_any(0x1);
 //	    refSpeedFloat = refSpeed.read() *0.86 + 0.145;
 		if (motorStartBtnChange.value) {motorRunner();}
 		else { motorStopper(); }
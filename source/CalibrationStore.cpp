@@ -0,0 +1,80 @@
+#include "CalibrationStore.h"
+#include <cstring>
+#include <cstddef>
+
+namespace {
+const uint32_t recordMagic = 0x44434c31;    // "DCL1"
+}
+
+CalibrationStore::CalibrationStore(uint32_t address) : _address(address)
+{
+}
+
+uint32_t CalibrationStore::checksum(const CalibrationStore::Record& record)
+{
+    // FNV-1a over record without checksum field
+    const auto *data = reinterpret_cast<const uint8_t*>(&record);
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(Record, checksum); i++) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+#if DEVICE_FLASH
+bool CalibrationStore::save(const DutyCalibrator::Table& table)
+{
+    Record record{};
+    record.magic = recordMagic;
+    record.size = table.size();
+    for (size_t i = 0; i < table.size(); i++) {
+        record.x[i] = table.x(i);
+        record.y[i] = table.y(i);
+    }
+    record.checksum = checksum(record);
+
+    FlashIAP flash;
+    if (flash.init() != 0) return false;
+    uint32_t address = _address;
+    if (address == 0) {
+        uint32_t end = flash.get_flash_start() + flash.get_flash_size();
+        address = end - flash.get_sector_size(end - 1);
+    }
+
+    // program size has to be multiple of page size
+    uint32_t pageSize = flash.get_page_size();
+    uint8_t buffer[(sizeof(Record) + 7) / 8 * 8] = {};
+    std::memcpy(buffer, &record, sizeof(Record));
+    uint32_t size = (sizeof(Record) + pageSize - 1) / pageSize * pageSize;
+    bool saved = size <= sizeof(buffer)
+                 && flash.erase(address, flash.get_sector_size(address)) == 0
+                 && flash.program(buffer, address, size) == 0;
+    flash.deinit();
+    return saved;
+}
+
+bool CalibrationStore::load(DutyCalibrator::Table& table)
+{
+    FlashIAP flash;
+    if (flash.init() != 0) return false;
+    uint32_t address = _address;
+    if (address == 0) {
+        uint32_t end = flash.get_flash_start() + flash.get_flash_size();
+        address = end - flash.get_sector_size(end - 1);
+    }
+    Record record;
+    bool read = flash.read(&record, address, sizeof(Record)) == 0;
+    flash.deinit();
+    if (!read || record.magic != recordMagic || record.size > DutyCalibrator::Table::capacity || record.checksum != checksum(record)) return false;
+
+    DutyCalibrator::Table stored;
+    for (size_t i = 0; i < record.size; i++) stored.setPoint(i, record.x[i], record.y[i]);
+    if (!stored.isMonotone()) return false;
+    table = stored;
+    return true;
+}
+#else
+bool CalibrationStore::save(const DutyCalibrator::Table&) { return false; }
+bool CalibrationStore::load(DutyCalibrator::Table&) { return false; }
+#endif
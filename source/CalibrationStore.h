@@ -0,0 +1,39 @@
+#pragma once
+
+#ifndef CALIBRATIONSTORE_H
+#define CALIBRATIONSTORE_H
+
+#include <mbed.h>
+#include "DutyCalibrator.h"
+
+/** Persist duty calibration table in internal flash
+ * Table is written with magic number and checksum to the last flash sector,
+ * which must not be used by the program (NUCLEO_F411RE: 128 KB sector at 0x08060000,
+ * kept out of the image by target.mbed_app_size in mbed_app.json and MBED_APP_SIZE of the CMake link script)
+ * Saving erases the whole sector, keep it to one-shot calibration
+ */
+class CalibrationStore {
+public:
+    /** @param address start of flash sector to use, 0 for last sector */
+    explicit CalibrationStore(uint32_t address = 0);
+
+    bool save(const DutyCalibrator::Table& table);
+
+    /** @return false if no valid table is stored, table is then unchanged */
+    bool load(DutyCalibrator::Table& table);
+
+private:
+    struct Record {
+        uint32_t magic;
+        uint32_t size;
+        float x[DutyCalibrator::Table::capacity];
+        float y[DutyCalibrator::Table::capacity];
+        uint32_t checksum;
+    };
+
+    static uint32_t checksum(const Record& record);
+
+    uint32_t _address;
+};
+
+#endif //CALIBRATIONSTORE_H
@@ -0,0 +1,93 @@
+#include "ControllerBenchmark.h"
+#include "PIDcontrol.h"
+#include "DiscretePID.h"
+#include "MotorCoordinator.h"
+
+namespace {
+    const unsigned int batch = 100;
+
+    float error(unsigned int i) { return (float)((i * 7919) % 200) * 0.1f - 10.0f; }
+
+    /** Average cycles of step(i) over steps, timed in batches with interrupts disabled */
+    template<typename Step>
+    uint32_t averageCycles(unsigned int steps, Step step)
+    {
+        uint32_t cycles = 0;
+        unsigned int count = 0;
+        while (count < steps) {
+            core_util_critical_section_enter();
+            uint32_t startCycle = DWT->CYCCNT;
+            for (unsigned int i = 0; i < batch; i++) step(count + i);
+            cycles += DWT->CYCCNT - startCycle;
+            core_util_critical_section_exit();
+            count += batch;
+        }
+        return cycles / count;
+    }
+
+    template<typename T>
+    void measureDiscrete(unsigned int steps, uint32_t& nominal, uint32_t& irregular)
+    {
+        DiscretePID<T, 1000> pid(0.2f, 2.0f, 0.08f);
+        pid.setOutputLimits(T(0), T(100));
+        volatile float sink;
+        nominal = averageCycles(steps, [&](unsigned int i) {
+            sink = (float)pid.step(T(error(i)), T(50.0f), 1000);
+        });
+        irregular = averageCycles(steps, [&](unsigned int i) {
+            sink = (float)pid.step(T(error(i)), T(50.0f), 1500 + (i & 255));
+        });
+        (void)sink;
+    }
+
+    /** Pulse source of a motor that never turns */
+    class IdleCounter : public PulseCounter {
+    public:
+        void start() override {}
+        void stop() override {}
+        long takePulses() override { return 0; }
+    };
+}
+
+ControllerCycles measureControllerCycles(unsigned int steps)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    ControllerCycles result;
+    PIDcontrol pid(0.2f, 2.0f, 0.08f);
+    pid.setOutputLimits(0.0f, 100.0f);
+    volatile float sink;
+    result.pidControl = averageCycles(steps, [&](unsigned int i) { sink = pid.compensateSignal(error(i), 50.0f, 1000); });
+    (void)sink;
+    measureDiscrete<float>(steps, result.discreteFloat, result.discreteFloatIrregular);
+    measureDiscrete<Q16_16>(steps, result.discreteFixed, result.discreteFixedIrregular);
+    return result;
+}
+
+CoordinatorCycles measureCoordinatorCycles(unsigned int passes)
+{
+    const PinName enable[CoordinatorCycles::maxAxes] = {PC_6, PC_8, PC_9};
+    const PinName direction[2 * CoordinatorCycles::maxAxes] = {PC_0, PC_1, PC_2, PC_3, PC_10, PC_11};
+    CoordinatorCycles result{};
+    if (passes == 0) return result;
+
+    // coordinator holds every axis in place, a few KB, only while measuring
+    auto coordinator = std::make_unique<MotorCoordinator<CoordinatorCycles::maxAxes>>(0.0f);
+    for (std::size_t k = 0; k < CoordinatorCycles::maxAxes; k++) {
+        coordinator->addAxis(std::make_tuple(std::unique_ptr<PulseCounter>(std::make_unique<IdleCounter>()),
+                                             1848u * 4 * 50, 10.0f),
+                             enable[k], direction[2 * k], direction[2 * k + 1], 0.2f, 2.0f, 0.08f, 0.48f);
+        coordinator->start({});
+        uint32_t cycles = 0;
+        for (unsigned int i = 0; i < passes; i++) {
+            coordinator->tick();
+            coordinator->run();
+            cycles += coordinator->getPassCycles();
+        }
+        result.pass[k] = cycles / passes;
+    }
+    coordinator->stop();
+    coordinator->run();
+    return result;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#ifndef CONTROLLERBENCHMARK_H
+#define CONTROLLERBENCHMARK_H
+
+#include <mbed.h>
+
+/** Average CPU cycles of one controller step of every PID implementation */
+struct ControllerCycles {
+    uint32_t pidControl;                // PIDcontrol::compensateSignal()
+    uint32_t discreteFloat;             // DiscretePID<float, 1000> at nominal period
+    uint32_t discreteFloatIrregular;    // DiscretePID<float, 1000> at irregular period
+    uint32_t discreteFixed;             // DiscretePID<Q16_16, 1000> at nominal period
+    uint32_t discreteFixedIrregular;    // DiscretePID<Q16_16, 1000> at irregular period
+};
+
+/** Measure controller step cost on target with DWT cycle counter
+ * Steps run in batches of 100 with interrupts disabled, run at start up before motor control starts
+ * Host counterpart is test/bench_discrete_pid.cpp
+ * @param steps steps per controller, rounded up to a whole batch
+ */
+ControllerCycles measureControllerCycles(unsigned int steps = 1000);
+
+/** Average CPU cycles of one MotorCoordinator::run() pass, pass[k] with k + 1 axes */
+struct CoordinatorCycles {
+    static constexpr std::size_t maxAxes = 3;
+    uint32_t pass[maxAxes];
+};
+
+/** Measure MotorCoordinator::getPassCycles() with 1 to maxAxes axes, linear scaling gives pass[k] / (k + 1) constant
+ * Axes run at reference 0 on encoders that never count, PWM of PC_6, PC_8 and PC_9 stays at duty 0 and
+ * direction pins are PC_0 - PC_3, PC_10 and PC_11, these pins must not be connected
+ * @param passes control ticks per number of axes
+ */
+CoordinatorCycles measureCoordinatorCycles(unsigned int passes = 100);
+
+#endif //CONTROLLERBENCHMARK_H
@@ -2,6 +2,21 @@
 #include "EncodedMotor.h"
 #include "mbed_stats.h" // resource monitor for heap
 #include "cmsis_os.h"   // resource monitor for stack
+#include "us_ticker_api.h"
+
+namespace {
+    volatile uint32_t idleTime_us = 0;      // accumulated by idleMonitorHook
+
+    void idleMonitorHook()
+    {
+        // sleep until next interrupt, ISR runs only after time is recorded
+        core_util_critical_section_enter();
+        uint32_t sleepStart = us_ticker_read();
+        sleep();
+        idleTime_us += us_ticker_read() - sleepStart;
+        core_util_critical_section_exit();
+    }
+}
 
 DebugMonitor::DebugMonitor(AnalogIn* knobPin, std::shared_ptr<EncodedMotor>& motorPtr, RawSerial* rawSerialPtr,
                            PinName I2C1_SDA, PinName I2C1_SDL, uint16_t lcdAddr, TextLCD::LCDType lcdtype, bool resourceEnabled) :
@@ -27,9 +42,9 @@ DebugMonitor::DebugMonitor(AnalogIn* knobPin, std::shared_ptr<EncodedMotor>& mot
 DebugMonitor::~DebugMonitor() = default;
 
 void DebugMonitor::printSignal() {
-	_speedData = _motorPtr->getSpeed();
-	_speed = std::get<0>(_speedData);
-	_timeDiff = std::get<1>(_speedData); 
+	_speedData = _motorPtr->getSample();
+	_speed = _speedData.speed;
+	_timeDiff = _speedData.time;
 	
 /*	//// Output to LCD2004
 	// analogWrite value
@@ -93,3 +108,21 @@ void DebugMonitor::printResource() {
 */
     }
 }
+
+void DebugMonitor::startIdleMonitor() {
+    _prevIdleReadTime = us_ticker_read();
+    _prevIdleTime = idleTime_us;
+    Thread::attach_idle_hook(&idleMonitorHook);
+    _idleMonitorStarted = true;
+}
+
+float DebugMonitor::readIdlePercent() {
+    if (!_idleMonitorStarted) return 0;
+    uint32_t now = us_ticker_read();
+    uint32_t idleTime = idleTime_us;
+    uint32_t elapsed = now - _prevIdleReadTime;
+    float idlePercent = elapsed ? (idleTime - _prevIdleTime) * 100.0f / elapsed : 0;
+    _prevIdleReadTime = now;
+    _prevIdleTime = idleTime;
+    return idlePercent;
+}
@@ -7,8 +7,8 @@
 #include <TextLCD.h>		// configure LCD at TextLCD_Config.h
 #include <tuple>
 #include <memory>
+#include "EncodedMotor.h"
 
-class EncodedMotor; 
 
 /** Add interface for debug using LCD2004 (tailored for GDM1718-12 group project)
  * Example: 
@@ -25,6 +25,16 @@ public:
 	void printSignal();
 	void printResource();
 
+	/** Measure CPU idle time by replacing the RTOS idle hook
+	 * Idle hook still sleeps the core, time spent in sleep is accumulated as idle time
+	 */
+	void startIdleMonitor();
+
+	/** CPU idle percentage since previous call (0 - 100)
+	 * return 0 if idle monitor is not started
+	 */
+	float readIdlePercent();
+
 private:
 	// LCD I2C Communication
 	I2C i2c;
@@ -34,11 +44,14 @@ private:
 	std::shared_ptr<EncodedMotor> _motorPtr;
 	RawSerial* _rawSerialPtr;
 	
-	std::tuple<double, unsigned long long> _speedData; 
-	double _speed = 0.0f;
+	SpeedSample _speedData;
+	float _speed = 0;
 	long long _timeDiff = 0;
 
 	bool _resourceEnabled = false;
+	bool _idleMonitorStarted = false;
+	uint32_t _prevIdleReadTime = 0;
+	uint32_t _prevIdleTime = 0;
 };
 
 
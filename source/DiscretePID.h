@@ -0,0 +1,198 @@
+#pragma once
+
+#ifndef DISCRETEPID_H
+#define DISCRETEPID_H
+
+#include <cstdint>
+#include "FixedPoint.h"
+
+/** Discretisation of integral and derivative terms
+ * BackwardEuler: I += Ki*T*e[k]
+ * Tustin: I += Ki*T/2*(e[k] + e[k-1])
+ */
+enum class Discretisation : uint8_t {BackwardEuler, Tustin};
+
+/** Integral coefficients and accumulator of DiscretePID, same type as the controller by default */
+template<typename T>
+struct DiscreteIntegral {
+    using coefficient_t = T;
+    using accumulator_t = T;
+    static coefficient_t coefficient(float value) { return value; }
+    static accumulator_t accumulate(T value) { return value; }
+    static T value(accumulator_t accumulator) { return accumulator; }
+    static accumulator_t product(coefficient_t coefficient, T error) { return coefficient * error; }
+};
+
+/** Q16.16 integrates in Q32.32, Ki*T down to 2^-32 keeps integral action
+ * (Ki*T of Q16.16 is 0 below 2^-17, e.g. Ki 0.005 at 1 kHz)
+ * Product of coefficient and error has to stay within 32768 per step
+ */
+template<>
+struct DiscreteIntegral<Q16_16> {
+    using coefficient_t = int64_t;      // Q32.32
+    using accumulator_t = int64_t;      // Q32.32
+    static coefficient_t coefficient(float value) { return (int64_t)(value * 4294967296.0f); }
+    static accumulator_t accumulate(Q16_16 value) { return (int64_t)value.raw() * Q16_16::one; }
+    static Q16_16 value(accumulator_t accumulator) { return Q16_16::fromRaw((int32_t)(accumulator >> 16)); }
+    static accumulator_t product(coefficient_t coefficient, Q16_16 error) {
+        return (coefficient * error.raw()) >> 16;
+    }
+};
+
+/** PID controller as precomputed difference equation
+ * Coefficients for the nominal period are computed once, each step is a few multiply-accumulates without divide
+ * A step with irregular period falls back to coefficients computed for that period (with divides)
+ * Derivative is taken on measurement and low-pass filtered, integral uses conditional anti-windup
+ * Integral is accumulated with DiscreteIntegral<T>, Q16.16 keeps it in Q32.32 so small Ki*T is not lost
+ *
+ * u[k] = Kp*e[k] + I[k] + D[k]
+ * I[k] = I[k-1] + c0*e[k] + c1*e[k-1]
+ * D[k] = ad*D[k-1] - bd*(y[k] - y[k-1])
+ *
+ * Example: DiscretePID<float, 1000> pid(0.2f, 2.0f, 0.08f);   // 1 kHz
+ *          float output = pid.step(error, measurement);
+ * @tparam T numeric type, float or Q16_16
+ * @tparam Period_us nominal sample period in microseconds
+ */
+template<typename T, uint32_t Period_us>
+class DiscretePID {
+    static_assert(Period_us > 0, "Sample period has to be greater than 0");
+public:
+    /** Difference equation coefficients for one sample period */
+    struct Coefficients {
+        T kp, ad, bd;
+        typename DiscreteIntegral<T>::coefficient_t c0, c1;
+    };
+
+    DiscretePID() = delete;
+    DiscretePID(float Kp, float Ki, float Kd, float derivativeCutoff = 0.2f,
+                Discretisation discretisation = Discretisation::BackwardEuler);
+
+    /** Step at nominal period */
+    T step(T error, T measurement);
+
+    /** Step at measured period, uses nominal coefficients if within 1/8 of nominal period */
+    T step(T error, T measurement, uint32_t timeStep_us);
+
+    void setOutputLimits(T minOutput, T maxOutput);
+
+    /** Restart from given output without bump */
+    void reset(T output = 0);
+
+    T getOutput() const { return _output; }
+    const Coefficients& getCoefficients() const { return _nominal; }
+
+private:
+    using Integral = DiscreteIntegral<T>;
+
+    Coefficients computeCoefficients(float period_s) const;
+    T step(const Coefficients& coefficients, T error, T measurement);
+
+    float _Kp, _Ki, _Kd;
+    float _derivativeTau;               // derivative filter time constant (s)
+    Discretisation _discretisation;
+    Coefficients _nominal;
+
+    typename Integral::accumulator_t _integral = 0;
+    T _derivative = 0;
+    T _prevError = 0;
+    T _prevMeasurement = 0;
+    T _output = 0;
+    T _minOutput = -30000;
+    T _maxOutput = 30000;
+    bool _hasPrev = false;
+};
+
+
+template<typename T, uint32_t Period_us>
+DiscretePID<T, Period_us>::DiscretePID(float Kp, float Ki, float Kd, float derivativeCutoff,
+                                       Discretisation discretisation)
+        : _Kp(Kp), _Ki(Ki), _Kd(Kd),
+          _derivativeTau(derivativeCutoff > 0 ? 1 / (2 * 3.14159265f * derivativeCutoff) : 0.0f),
+          _discretisation(discretisation), _nominal(computeCoefficients(Period_us * 1e-6f))
+{
+}
+
+template<typename T, uint32_t Period_us>
+typename DiscretePID<T, Period_us>::Coefficients DiscretePID<T, Period_us>::computeCoefficients(float period_s) const
+{
+    Coefficients coefficients;
+    coefficients.kp = _Kp;
+    bool tustin = _discretisation == Discretisation::Tustin;
+    coefficients.c0 = Integral::coefficient(tustin ? _Ki * period_s / 2 : _Ki * period_s);
+    coefficients.c1 = Integral::coefficient(tustin ? _Ki * period_s / 2 : 0.0f);
+    if (tustin && _derivativeTau > 0) {
+        coefficients.ad = (2 * _derivativeTau - period_s) / (2 * _derivativeTau + period_s);
+        coefficients.bd = 2 * _Kd / (2 * _derivativeTau + period_s);
+    }
+    else {
+        // unfiltered Tustin derivative would alternate sign, use backward Euler
+        coefficients.ad = _derivativeTau / (_derivativeTau + period_s);
+        coefficients.bd = _Kd / (_derivativeTau + period_s);
+    }
+    return coefficients;
+}
+
+template<typename T, uint32_t Period_us>
+T DiscretePID<T, Period_us>::step(T error, T measurement)
+{
+    return step(_nominal, error, measurement);
+}
+
+template<typename T, uint32_t Period_us>
+T DiscretePID<T, Period_us>::step(T error, T measurement, uint32_t timeStep_us)
+{
+    uint32_t deviation = timeStep_us > Period_us ? timeStep_us - Period_us : Period_us - timeStep_us;
+    if (deviation <= Period_us / 8) return step(_nominal, error, measurement);
+    if (timeStep_us == 0) return _output;
+    return step(computeCoefficients(timeStep_us * 1e-6f), error, measurement);
+}
+
+template<typename T, uint32_t Period_us>
+T DiscretePID<T, Period_us>::step(const Coefficients& coefficients, T error, T measurement)
+{
+    if (!_hasPrev) {
+        // bumpless start from current output
+        _integral = Integral::accumulate(_output - coefficients.kp * error);
+        _prevError = error;
+        _prevMeasurement = measurement;
+        _hasPrev = true;
+    }
+    _derivative = coefficients.ad * _derivative - coefficients.bd * (measurement - _prevMeasurement);
+    auto integral = _integral + Integral::product(coefficients.c0, error)
+                    + Integral::product(coefficients.c1, _prevError);
+    T output = coefficients.kp * error + Integral::value(integral) + _derivative;
+
+    // conditional integration, hold integrator while saturated in direction of error
+    if (output > _maxOutput) {
+        output = _maxOutput;
+        if (error < 0) _integral = integral;
+    }
+    else if (output < _minOutput) {
+        output = _minOutput;
+        if (error > 0) _integral = integral;
+    }
+    else _integral = integral;
+
+    _prevError = error;
+    _prevMeasurement = measurement;
+    _output = output;
+    return output;
+}
+
+template<typename T, uint32_t Period_us>
+void DiscretePID<T, Period_us>::setOutputLimits(T minOutput, T maxOutput)
+{
+    _minOutput = minOutput;
+    _maxOutput = maxOutput;
+}
+
+template<typename T, uint32_t Period_us>
+void DiscretePID<T, Period_us>::reset(T output)
+{
+    _derivative = 0;
+    _output = output;
+    _hasPrev = false;
+}
+
+#endif //DISCRETEPID_H
@@ -0,0 +1,55 @@
+#include "DutyCalibrator.h"
+#include <cmath>
+
+namespace {
+const float sweepDuty[] = {0.0f, 5.0f, 10.0f, 15.0f, 20.0f, 30.0f, 45.0f, 65.0f, 100.0f};
+const unsigned int sweepSteps = sizeof(sweepDuty) / sizeof(sweepDuty[0]);
+const float minFullSpeed = 1.0f;        // speed at full duty below this means motor or encoder is not working
+}
+
+void DutyCalibrator::start(uint32_t settleTime_us)
+{
+    static_assert(sweepSteps <= 9, "Sweep does not fit in calibration table");
+    _settleTime_us = settleTime_us;
+    _table.clear();
+    _step = 0;
+    _hasStepTime = false;
+    _sumSpeed = 0.0f;
+    _speedCount = 0;
+    _state = State::Running;
+}
+
+float DutyCalibrator::update(float speed, uint32_t time_us)
+{
+    if (_state != State::Running) return 0.0f;
+    if (!_hasStepTime) {
+        _hasStepTime = true;
+        _stepTime = time_us;
+    }
+
+    uint32_t elapsed = time_us - _stepTime;
+    if (elapsed >= _settleTime_us / 2) {
+        // average once transient of the step has settled
+        _sumSpeed += std::abs(speed);
+        _speedCount++;
+    }
+    if (elapsed >= _settleTime_us && _speedCount > 0) {
+        float meanSpeed = _sumSpeed / _speedCount;
+        if (_step > 0 && meanSpeed < _table.y(_step - 1)) meanSpeed = _table.y(_step - 1);     // keep monotone
+        _table.setPoint(_step, sweepDuty[_step], meanSpeed);
+        _step++;
+        _stepTime = time_us;
+        _sumSpeed = 0.0f;
+        _speedCount = 0;
+        if (_step == sweepSteps) {
+            _state = _table.y(sweepSteps - 1) < minFullSpeed ? State::Failed : State::Finished;
+            return 0.0f;
+        }
+    }
+    return sweepDuty[_step];
+}
+
+void DutyCalibrator::abort()
+{
+    _state = State::Failed;
+}
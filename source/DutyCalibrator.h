@@ -0,0 +1,58 @@
+#pragma once
+
+#ifndef DUTYCALIBRATOR_H
+#define DUTYCALIBRATOR_H
+
+#include <cstdint>
+#include "LookupTable.h"
+
+/** One-shot calibration of duty to speed curve
+ * Sweeps duty up through fixed steps (dense near deadband), holds each step for settle time and
+ * records mean speed over second half of the hold. The resulting monotone table gives deadband
+ * and nonlinearity of driver and motor, inverse of it linearises duty (see MotorControl::setLinearisation)
+ * Free of mbed, update() is called at control rate with measured speed and time
+ *
+ * Example:
+ * DutyCalibrator calibrator;
+ * calibrator.start();
+ * duty = calibrator.update(speed, time_us);  // until !calibrator.isRunning()
+ */
+class DutyCalibrator {
+public:
+    using Table = LookupTable<9>;       // duty (0 - 100) to speed
+    enum class State : uint8_t {Idle, Running, Finished, Failed};
+
+    DutyCalibrator() = default;
+
+    /** Start sweep from duty 0
+     * @param settleTime_us hold time at every duty step
+     */
+    void start(uint32_t settleTime_us = 1000000);
+
+    /** Step sweep, return duty to apply
+     * @param speed measured speed
+     * @param time_us current time in microseconds
+     */
+    float update(float speed, uint32_t time_us);
+
+    void abort();
+
+    State getState() const { return _state; }
+    bool isRunning() const { return _state == State::Running; }
+    bool isFinished() const { return _state == State::Finished; }
+
+    /** Measured curve, valid when finished */
+    const Table& getTable() const { return _table; }
+
+private:
+    State _state = State::Idle;
+    Table _table;
+    uint32_t _settleTime_us = 0;
+    unsigned int _step = 0;
+    bool _hasStepTime = false;
+    uint32_t _stepTime = 0;             // time current duty step started (us)
+    float _sumSpeed = 0.0f;
+    unsigned int _speedCount = 0;
+};
+
+#endif //DUTYCALIBRATOR_H
@@ -3,68 +3,317 @@
 //
 
 #include "EncodedMotor.h"
+#include "InterruptPulseCounter.h"
+#include "TimerPulseCounter.h"
+#include <cstdlib>
+#include <cmath>
+#include <limits>
 //#include <TextLCD.h>
 //#include <functional>
 
+namespace {
+    const unsigned long standstillTime_us = 500000;     // no edge for 0.5s is treated as standstill
 
-EncodedMotor::EncodedMotor(PinName encoderA, PinName encoderB, unsigned int pulsePerRotation,
-        float samplingRate, EncodeType encodeType) :_encoderAInterrupt(encoderA), _encoderBInterrupt(encoderB),
-                                                    _pulsePerRotation(pulsePerRotation),
-                                                    _samplingRate(samplingRate), _samplingPeriod(1/samplingRate),
-                                                    _encodeType(encodeType)
-{
-    switch(_encodeType){
-    case EncodeType::X1:
-        _encoderAInterrupt.rise(callback(this, &EncodedMotor::incrementPulse));
-        break;
-    case EncodeType::X2:
-        _encoderAInterrupt.rise(callback(this, &EncodedMotor::incrementPulse));
-        _encoderAInterrupt.fall(callback(this, &EncodedMotor::incrementPulse));
-        break;
-    case EncodeType::X4:
-        _encoderAInterrupt.rise(callback(this, &EncodedMotor::incrementPulse));
-        _encoderAInterrupt.fall(callback(this, &EncodedMotor::incrementPulse));
-        _encoderBInterrupt.rise(callback(this, &EncodedMotor::incrementPulse));
-        _encoderBInterrupt.fall(callback(this, &EncodedMotor::incrementPulse));
-        break;
+    std::unique_ptr<PulseCounter> makePulseCounter(PinName encoderA, PinName encoderB,
+            EncodeType encodeType, EncoderBackend backend, Timer* edgeTimer)
+    {
+        if (backend == EncoderBackend::Timer)
+            return std::make_unique<TimerPulseCounter>(encoderA, encoderB, encodeType);
+        return std::make_unique<InterruptPulseCounter>(encoderA, encoderB, encodeType, edgeTimer);
     }
+}
+
+EncodedMotor::EncodedMotor(PinName encoderA, PinName encoderB, unsigned int pulsePerRotation,
+        float samplingRate, EncodeType encodeType, EncoderBackend backend, SpeedEstimator estimator)
+        : EncodedMotor(makePulseCounter(encoderA, encoderB, encodeType, backend,
+                                        estimator == SpeedEstimator::PulseCount ? nullptr : &timer),
+                       pulsePerRotation, samplingRate, estimator)
+{
+}
 
+EncodedMotor::EncodedMotor(std::unique_ptr<PulseCounter> pulseCounter, unsigned int pulsePerRotation,
+        float samplingRate, SpeedEstimator estimator) : _pulseCounter(std::move(pulseCounter)),
+                              _pulsePerRotation(pulsePerRotation),
+                              _samplingRate(samplingRate), _samplingPeriod(1/samplingRate),
+                              _estimator(estimator), _rpmPerPulseRate(60 * 1000000.0f / pulsePerRotation)
+{
+    if (!_pulseCounter->hasEdgeTime()) _estimator = SpeedEstimator::PulseCount;
+    start();
+}
+void EncodedMotor::start()
+{
+    // enable DWT cycle counter for saveData() cost measurement
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    _pulseCounter->start();
     timer.start();
     ticker.attach(callback(this, &EncodedMotor::saveData), _samplingPeriod);
-
 }
 void EncodedMotor::saveData()
 {
+    uint32_t startCycle = DWT->CYCCNT;
     unsigned long long currentTime = timer.read_high_resolution_us();
-    unsigned long long time_us =currentTime - _previousSaveTime;
+    auto time_us = (uint32_t)(currentTime - _previousSaveTime);     // sampling period fits in 32-bit
     _previousSaveTime = currentTime;
-    double time_m = time_us/60/1000000.0;
-    float rotation = (_pulseBuffer/(float)_pulsePerRotation); //rotation amount (rev)
-    _pulseBuffer = 0;
-    _speed = rotation/time_m; //rpm
+
+    // pulses leave the counter and enter _sample.position within one write, readers never miss them
+    uint32_t sequence = beginPublish();
+    long pulses = _pulseCounter->takePulses();
+    _position += pulses;
+    bool reached = false;
+    if (_compareDirection != 0) {
+        // counter compare is relative to pulses since takePulses(), re-arm it for the new period
+        reached = (_position - _compareTarget) * _compareDirection >= 0;
+        if (reached) _pulseCounter->disarmCompare();
+        else armCounterCompare();
+    }
+    float speed = 0;
+
+    if (_estimator == SpeedEstimator::PulseCount) {
+        if (time_us > 0) speed = _rpmPerPulseRate * pulses / time_us; //rpm
+        if (pulses != 0) _lastEdgeTime = currentTime;
+    }
+    else {
+        PulseCounter::EdgeTime edgeTime = _pulseCounter->getEdgeTime();
+        speed = estimateSpeed(pulses, edgeTime, _previousEdgeTime, currentTime);
+        _previousEdgeTime = edgeTime.lastEdge;
+        _lastEdgeTime = edgeTime.lastEdge;
+    }
+    _filteredSpeed += _filterGain * (speed - _filteredSpeed);
+    _sample.speed = _filteredSpeed;
+    _sample.time = currentTime;
+    _sample.lastEdge = _lastEdgeTime;
+    _sample.position = _position;
+    _sample.sequence = sequence / 2 + 1;
+    endPublish(sequence);
+
+    // callbacks run after the write, they may read the sample
+    if (reached) fireCompare();
+    _saveDataCycles = DWT->CYCCNT - startCycle;
+    if (_sampleCallback) _sampleCallback.call();
 }
-void EncodedMotor::Stop()
+uint32_t EncodedMotor::beginPublish()
 {
-    switch(_encodeType){
-    case EncodeType::X1:
-        _encoderAInterrupt.rise(NULL);
-        break;
-    case EncodeType::X2:
-        _encoderAInterrupt.rise(NULL);
-        _encoderAInterrupt.fall(NULL);
-        break;
-    case EncodeType::X4:
-        _encoderAInterrupt.rise(NULL);
-        _encoderAInterrupt.fall(NULL);
-        _encoderBInterrupt.rise(NULL);
-        _encoderBInterrupt.fall(NULL);
-        break;
+    // sequence lock writer, only called from Ticker ISR hence never concurrent with itself
+    uint32_t sequence = _writeSequence.load(std::memory_order_relaxed);
+    _writeSequence.store(sequence + 1, std::memory_order_relaxed);     // odd, write in progress
+    std::atomic_thread_fence(std::memory_order_release);
+    return sequence;
+}
+void EncodedMotor::endPublish(uint32_t sequence)
+{
+    std::atomic_thread_fence(std::memory_order_release);
+    _writeSequence.store(sequence + 2, std::memory_order_relaxed);     // even, write completed
+}
+float EncodedMotor::estimateSpeed(long pulses, const PulseCounter::EdgeTime& edgeTime,
+                                    unsigned long long previousEdgeTime, unsigned long long currentTime) const
+{
+    auto edgeTime_us = (uint32_t)(edgeTime.lastEdge - previousEdgeTime);
+    if (_estimator == SpeedEstimator::Hybrid && (unsigned long)std::abs(pulses) >= _hybridThreshold
+        && previousEdgeTime != 0 && edgeTime_us > 0) {
+        // M/T-method, whole pulses over the exact time they took
+        return _rpmPerPulseRate * pulses / edgeTime_us;
     }
+    return edgePeriodSpeed(edgeTime, currentTime);
+}
+float EncodedMotor::edgePeriodSpeed(const PulseCounter::EdgeTime& edgeTime, unsigned long long currentTime) const
+{
+    if (edgeTime.direction == 0) return 0;          // no edge yet
+
+    // T-method, the edge period is bounded below by time elapsed since latest edge
+    unsigned long long sinceEdge_us = currentTime - edgeTime.lastEdge;
+    if (sinceEdge_us > standstillTime_us) return 0;
+    auto period_us = (uint32_t)edgeTime.edgePeriod;
+    if (period_us == 0 || sinceEdge_us > period_us) period_us = (uint32_t)sinceEdge_us;
+    if (period_us == 0) return 0;
+    return _rpmPerPulseRate * edgeTime.direction / period_us;
+}
+void EncodedMotor::Stop()
+{
+    _pulseCounter->stop();
+    ticker.detach();
+
+}
+std::tuple<float, unsigned long long> EncodedMotor::getSpeed() const
+{
+    SpeedSample sample = getSample();
+    return std::make_tuple(sample.speed, sample.time);
+}
+void EncodedMotor::setSamplingRate(float samplingRate)
+{
     ticker.detach();
+    _samplingRate = samplingRate;
+    _samplingPeriod = 1/samplingRate;
+    updateFilterGain();
+    ticker.attach(callback(this, &EncodedMotor::saveData), _samplingPeriod);
+}
+float EncodedMotor::getSamplingRate() const
+{
+    return _samplingRate;
+}
+SpeedEstimator EncodedMotor::getEstimator() const
+{
+    return _estimator;
+}
+void EncodedMotor::setSpeedFilter(float cutoffFrequency)
+{
+    _filterCutoff = cutoffFrequency;
+    updateFilterGain();
+}
+void EncodedMotor::updateFilterGain()
+{
+    // exact discretisation of first order low-pass at nominal sampling period
+    _filterGain = (_filterCutoff > 0) ? 1 - std::exp(-2 * (float)M_PI * _filterCutoff * _samplingPeriod) : 1.0f;
+}
+void EncodedMotor::attachSampleCallback(Callback<void()> func)
+{
+    // sampling ISR may call the callback, never let it see a half written one
+    core_util_critical_section_enter();
+    _sampleCallback = func;
+    core_util_critical_section_exit();
+}
+SpeedSample EncodedMotor::getSample() const
+{
+    SpeedSample sample;
+    uint32_t begin, end;
+    do {
+        begin = _writeSequence.load(std::memory_order_acquire);
+        sample = _sample;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        end = _writeSequence.load(std::memory_order_relaxed);
+    } while (begin != end || (begin & 1u));     // retry if sample was written during copy
+    return sample;
+}
+SpeedSample EncodedMotor::getLiveSample()
+{
+    if (_estimator == SpeedEstimator::PulseCount) {
+        SpeedSample sample = getSample();
+        sample.position = getPosition();
+        return sample;
+    }
+
+    // snapshot of what saveData() would see now, retried if a sample is published or an edge is counted
+    // while copying, previous edge time of saveData() is lastEdge of the published sample
+    SpeedSample sample;
+    PulseCounter::EdgeTime edgeTime;
+    long pulses;
+    uint32_t begin, end, edgeBegin, edgeEnd;
+    do {
+        begin = _writeSequence.load(std::memory_order_acquire);
+        edgeBegin = _pulseCounter->getEdgeSequence();
+        std::atomic_thread_fence(std::memory_order_acquire);
+        sample = _sample;
+        edgeTime = _pulseCounter->getEdgeTime();
+        pulses = _pulseCounter->peekPulses();
+        std::atomic_thread_fence(std::memory_order_acquire);
+        edgeEnd = _pulseCounter->getEdgeSequence();
+        end = _writeSequence.load(std::memory_order_relaxed);
+    } while (begin != end || (begin & 1u) || edgeBegin != edgeEnd || (edgeBegin & 1u));
+    unsigned long long previousEdgeTime = sample.lastEdge;
+    unsigned long long currentTime = timer.read_high_resolution_us();
 
+    float speed = estimateSpeed(pulses, edgeTime, previousEdgeTime, currentTime);
+    if (_filterCutoff > 0) {
+        // advance filter from last sample over the time since it, without changing filter state
+        float gain = 1 - std::exp(-2 * (float)M_PI * _filterCutoff * (float)(currentTime - sample.time) * 1e-6f);
+        speed = sample.speed + gain * (speed - sample.speed);
+    }
+    sample.speed = speed;
+    sample.time = currentTime;
+    if (edgeTime.direction != 0) sample.lastEdge = edgeTime.lastEdge;
+    sample.position += pulses;
+    return sample;
+}
+unsigned long EncodedMotor::getInvalidTransitions() const
+{
+    return _pulseCounter->getInvalidTransitions();
+}
+void EncodedMotor::setHybridThreshold(unsigned int hybridThreshold)
+{
+    _hybridThreshold = hybridThreshold;
+}
+unsigned int EncodedMotor::getPulsePerRotation() const
+{
+    return _pulsePerRotation;
+}
+void EncodedMotor::setTravelPerRotation(float travelPerRotation)
+{
+    _travelPerRotation = travelPerRotation;
+}
+float EncodedMotor::getTravelPerRotation() const
+{
+    return _travelPerRotation;
+}
+int64_t EncodedMotor::getPosition() const
+{
+    // sample position plus pulses not taken yet, retry if a sample drained the counter meanwhile
+    int64_t position;
+    uint32_t begin, end;
+    do {
+        begin = _writeSequence.load(std::memory_order_acquire);
+        position = _sample.position + _pulseCounter->peekPulses();
+        std::atomic_thread_fence(std::memory_order_acquire);
+        end = _writeSequence.load(std::memory_order_relaxed);
+    } while (begin != end || (begin & 1u));
+    return position;
+}
+float EncodedMotor::getPositionMillimetres() const
+{
+    return pulsesToMillimetres(getPosition());
+}
+float EncodedMotor::pulsesToMillimetres(int64_t pulses) const
+{
+    return (float)pulses * _travelPerRotation / _pulsePerRotation;
+}
+int64_t EncodedMotor::millimetresToPulses(float millimetres) const
+{
+    if (_travelPerRotation <= 0) return 0;
+    return std::llround(millimetres * _pulsePerRotation / _travelPerRotation);
+}
+void EncodedMotor::setCompare(int64_t position, Callback<void()> func)
+{
+    // encoder and sampling ISR cannot run while compare is replaced
+    core_util_critical_section_enter();
+    _pulseCounter->disarmCompare();
+    _compareDirection = 0;
+    int64_t current = _position + _pulseCounter->peekPulses();
+    bool reached = func && position == current;
+    if (func && !reached) {
+        _compareTarget = position;
+        _compareCallback = func;
+        _compareDirection = position > current ? 1 : -1;
+        armCounterCompare();
+    }
+    core_util_critical_section_exit();
+    if (reached) func.call();
+}
+void EncodedMotor::clearCompare()
+{
+    setCompare(0, NULL);
+}
+void EncodedMotor::armCounterCompare()
+{
+    // target too far for one period is checked again at next sample
+    int64_t remaining = _compareTarget - _position;
+    if (remaining > std::numeric_limits<long>::max() || remaining < std::numeric_limits<long>::min())
+        _pulseCounter->disarmCompare();
+    else
+        _pulseCounter->armCompare((long)remaining, _compareDirection, &EncodedMotor::counterCompare, this);
+}
+void EncodedMotor::fireCompare()
+{
+    // disarm first, callback may set next compare
+    _compareDirection = 0;
+    _pulseCounter->disarmCompare();
+    Callback<void()> func = _compareCallback;
+    func.call();
+}
+void EncodedMotor::counterCompare(void* context)
+{
+    static_cast<EncodedMotor*>(context)->fireCompare();
 }
-std::tuple<double, unsigned long long> EncodedMotor::getSpeed() const
+uint32_t EncodedMotor::getSaveDataCycles() const
 {
-//    unsigned long long timeDiff_us = _previousSaveTime - _previousReadTime;
-    return std::make_tuple(_speed, _previousSaveTime);
+    return _saveDataCycles;
 }
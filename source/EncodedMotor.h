@@ -7,41 +7,179 @@
 
 #include <mbed.h>
 #include <tuple>
+#include <memory>
+#include <atomic>
+#include "PulseCounter.h"
 
-enum class EncodeType:uint8_t {
-  X1 = 1,
-  X2 = 2,
-  X4 = 4
+/** Hardware used to count encoder pulses
+ * Interrupt: InterruptIn on any pin, one ISR per counted edge
+ * Timer: STM32 TIM1 encoder interface, encoder must be on PA_8 and PA_9
+ */
+enum class EncoderBackend:uint8_t {
+  Interrupt,
+  Timer
 };
+
+/** Method used to estimate speed at every sampling period
+ * PulseCount: pulses counted over the sampling period (M-method), coarse at low speed
+ * EdgePeriod: period of latest encoder edge (T-method), fine at low speed, noisy at high speed
+ * Hybrid: pulses over time between the last edges of consecutive periods (M/T-method),
+ *         falls back to EdgePeriod when fewer than hybridThreshold pulses are counted
+ * EdgePeriod and Hybrid require a counter that timestamps edges, otherwise PulseCount is used
+ */
+enum class SpeedEstimator:uint8_t {
+  PulseCount,
+  EdgePeriod,
+  Hybrid
+};
+
+/** Speed sample published by EncodedMotor at every sampling period */
+struct SpeedSample {
+    float speed = 0;              // signed speed in RPM (positive when encoder B leads A)
+    unsigned long long time = 0;    // time of sample in us
+    uint32_t sequence = 0;          // sample number, increments by 1 at every sampling period
+    unsigned long long lastEdge = 0;    // time of latest encoder edge in us (sample time of last counted pulse with PulseCount)
+    int64_t position = 0;           // pulses counted since start (positive when encoder B leads A)
+};
+
 class EncodedMotor {
 public:
     EncodedMotor() = delete;
     EncodedMotor(PinName encoderA, PinName encoderB, unsigned int pulsePerRotation,
-            float samplingRate = 1.0f, EncodeType encodeType = EncodeType::X1);
+            float samplingRate = 1.0f, EncodeType encodeType = EncodeType::X1,
+            EncoderBackend backend = EncoderBackend::Interrupt,
+            SpeedEstimator estimator = SpeedEstimator::PulseCount);
+
+    /** Construct with custom pulse source
+     * @param pulseCounter source of pulses, e.g. a fake counter for host testing
+     * edge times of pulseCounter must be in us of the same time base as EncodedMotor
+     */
+    EncodedMotor(std::unique_ptr<PulseCounter> pulseCounter, unsigned int pulsePerRotation,
+            float samplingRate = 1.0f, SpeedEstimator estimator = SpeedEstimator::PulseCount);
 
     void Stop();
-    std::tuple<double, unsigned long long> getSpeed() const;
+
+    /** Get speed of last sampling period
+     * @return signed speed in RPM (positive when encoder B leads A) and time of sample in us
+     */
+    std::tuple<float, unsigned long long> getSpeed() const;
+
+    /** Get consistent copy of last published sample, lock-free and safe from any thread
+     * Retries if a new sample is published while reading, never disables interrupts
+     * Compare SpeedSample::sequence to detect new sample
+     */
+    SpeedSample getSample() const;
+
+    /** Estimate speed now from edges counted since last sample, for control ticks between samples
+     * EdgePeriod and Hybrid apply the same estimator to the latest edge at read time, so speed follows
+     * every encoder edge instead of every sampling period; filter (if set) is advanced to current time
+     * PulseCount cannot estimate between samples and returns getSample() with live position
+     * Copies counter state lock-free, retried if an edge or sample is counted meanwhile, never disables interrupts
+     * @return sample with time of reading, sequence of the last published sample
+     */
+    SpeedSample getLiveSample();
+
+    /** Attach function called from sampling ISR right after a new sample is published
+     * Keep it ISR safe and short, e.g. set EventFlags to wake the control thread
+     * Safe to call while sampling is running
+     * @param func callback, NULL to detach
+     */
+    void attachSampleCallback(Callback<void()> func);
+
+    /** Number of invalid quadrature transitions detected by the pulse counter
+     * Non-zero count indicates encoder bounce, noise or missed edges
+     */
+    unsigned long getInvalidTransitions() const;
+
+    /** Set minimum pulses per sampling period for Hybrid estimator to use M/T-method
+     * @param hybridThreshold default is 8
+     */
+    void setHybridThreshold(unsigned int hybridThreshold = 8);
+
+    /** Change speed sampling rate, restarts the sampling ticker
+     * @param samplingRate speed estimation rate in Hz
+     */
+    void setSamplingRate(float samplingRate);
+    float getSamplingRate() const;
+
+    /** Estimator in use, PulseCount if the counter cannot timestamp edges */
+    SpeedEstimator getEstimator() const;
+
+    /** Low-pass filter published speed with first order IIR filter
+     * Filter runs at sampling rate, so a filtered speed is available at every control tick
+     * @param cutoffFrequency cutoff frequency in Hz, 0 to disable (default)
+     */
+    void setSpeedFilter(float cutoffFrequency = 0);
+
+    unsigned int getPulsePerRotation() const;
+
+    /** Set travel per rotation of encoder shaft (drive ratio) for conversion of position to mm
+     * @param travelPerRotation in mm, 0 if unknown (default)
+     */
+    void setTravelPerRotation(float travelPerRotation);
+    float getTravelPerRotation() const;
+
+    /** Live position including pulses counted since last sample, lock-free and safe from any thread
+     * @return pulses since start (positive when encoder B leads A)
+     */
+    int64_t getPosition() const;
+    float getPositionMillimetres() const;       // 0 if travel per rotation is not set
+    float pulsesToMillimetres(int64_t pulses) const;
+    int64_t millimetresToPulses(float millimetres) const;
+
+    /** Call function once when position reaches target, ISR and thread safe
+     * Only one compare is armed, a new one replaces it. Direction is taken from current position,
+     * function is called right away if position is already at target
+     * Interrupt backend checks at every edge, Timer backend at every sampling period
+     * Called from ISR, compare is disarmed before the call so the function may arm the next target
+     * @param position target in pulses, see getPosition()
+     * @param func callback, NULL to disarm
+     */
+    void setCompare(int64_t position, Callback<void()> func);
+    void clearCompare();
+
+    /** CPU cycles taken by the latest sampling ISR */
+    uint32_t getSaveDataCycles() const;
 
 
 private:
     //Methods
-    void incrementPulse(){
-        _pulseBuffer++;
-    }
-
+    void start();
     void saveData();
+    uint32_t beginPublish();                // open sample write, readers retry until endPublish()
+    void endPublish(uint32_t sequence);
+    void updateFilterGain();
+    float edgePeriodSpeed(const PulseCounter::EdgeTime& edgeTime, unsigned long long currentTime) const;
+    float estimateSpeed(long pulses, const PulseCounter::EdgeTime& edgeTime, unsigned long long previousEdgeTime,
+                          unsigned long long currentTime) const;
+    void armCounterCompare();
+    void fireCompare();
+    static void counterCompare(void* context);
 
     //Data
-    InterruptIn _encoderAInterrupt, _encoderBInterrupt;
+    std::unique_ptr<PulseCounter> _pulseCounter;
     const unsigned int _pulsePerRotation;
     float _samplingRate;
 	float _samplingPeriod;
-    EncodeType _encodeType;
+    float _filterCutoff = 0;
+    float _filterGain = 1;                // IIR gain per sample, 1 when filter is disabled
+    float _filteredSpeed = 0;
+    SpeedEstimator _estimator;
+    unsigned int _hybridThreshold = 8;
+    const float _rpmPerPulseRate;         // RPM of 1 pulse per us
 
-    double _speed = 0;
-    unsigned long _pulseBuffer = 0;
+    unsigned long long _previousEdgeTime = 0;   // time of last edge of previous sampling period
     unsigned long long _previousSaveTime = 0;
-    unsigned long long _previousReadTime = 0;
+    unsigned long long _lastEdgeTime = 0;       // time of latest edge, or of latest sample with pulses
+    int64_t _position = 0;                      // sum of pulses of all sampling periods
+    float _travelPerRotation = 0;               // mm per rotation of encoder shaft
+    int64_t _compareTarget = 0;
+    volatile int8_t _compareDirection = 0;      // +1 / -1 towards target, 0 when disarmed
+    Callback<void()> _compareCallback;
+    SpeedSample _sample;                        // written only between beginPublish() and endPublish()
+    std::atomic<uint32_t> _writeSequence{0};    // odd while _sample is being written
+    volatile uint32_t _saveDataCycles = 0;
+    Callback<void()> _sampleCallback;
     Timer timer;
     Ticker ticker;
 
@@ -0,0 +1,52 @@
+#pragma once
+
+#ifndef FIXEDPOINT_H
+#define FIXEDPOINT_H
+
+#include <cstdint>
+
+/** Signed Q16.16 fixed point number
+ * Range -32768 ~ 32767.99998, resolution 1/65536
+ * Arithmetic uses integer instructions only, products and quotients go through 64-bit intermediate
+ * Example: Q16_16 speed = 0.48f; float value = speed.toFloat();
+ */
+class Q16_16 {
+public:
+    static constexpr int fractionBits = 16;
+    static constexpr int32_t one = 1 << fractionBits;
+
+    constexpr Q16_16() = default;
+    constexpr Q16_16(float value) : _raw((int32_t)(value * one + (value >= 0 ? 0.5f : -0.5f))) {}
+    constexpr Q16_16(int value) : _raw(value * one) {}
+
+    static constexpr Q16_16 fromRaw(int32_t raw) { Q16_16 result; result._raw = raw; return result; }
+    constexpr int32_t raw() const { return _raw; }
+    constexpr float toFloat() const { return _raw * (1.0f / one); }
+    explicit constexpr operator float() const { return toFloat(); }
+
+    constexpr Q16_16 operator-() const { return fromRaw(-_raw); }
+    constexpr Q16_16 operator+(Q16_16 rhs) const { return fromRaw(_raw + rhs._raw); }
+    constexpr Q16_16 operator-(Q16_16 rhs) const { return fromRaw(_raw - rhs._raw); }
+    constexpr Q16_16 operator*(Q16_16 rhs) const {
+        return fromRaw((int32_t)(((int64_t)_raw * rhs._raw) >> fractionBits));
+    }
+    constexpr Q16_16 operator/(Q16_16 rhs) const {
+        return fromRaw((int32_t)(((int64_t)_raw << fractionBits) / rhs._raw));
+    }
+    Q16_16& operator+=(Q16_16 rhs) { _raw += rhs._raw; return *this; }
+    Q16_16& operator-=(Q16_16 rhs) { _raw -= rhs._raw; return *this; }
+    Q16_16& operator*=(Q16_16 rhs) { return *this = *this * rhs; }
+    Q16_16& operator/=(Q16_16 rhs) { return *this = *this / rhs; }
+
+    constexpr bool operator==(Q16_16 rhs) const { return _raw == rhs._raw; }
+    constexpr bool operator!=(Q16_16 rhs) const { return _raw != rhs._raw; }
+    constexpr bool operator<(Q16_16 rhs) const { return _raw < rhs._raw; }
+    constexpr bool operator>(Q16_16 rhs) const { return _raw > rhs._raw; }
+    constexpr bool operator<=(Q16_16 rhs) const { return _raw <= rhs._raw; }
+    constexpr bool operator>=(Q16_16 rhs) const { return _raw >= rhs._raw; }
+
+private:
+    int32_t _raw = 0;
+};
+
+#endif //FIXEDPOINT_H
@@ -0,0 +1,66 @@
+#pragma once
+
+#ifndef GAINSCHEDULE_H
+#define GAINSCHEDULE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/** PID gains at one reference speed */
+struct GainPoint {
+    float reference;        // reference the gains are tuned for
+    float Kp;
+    float Ki;
+    float Kd;
+};
+
+/** Gain schedule indexed by reference, linearly interpolated between points
+ * Points are kept in caller storage (e.g. static constexpr std::array), sorted by ascending reference,
+ * a temporary array is rejected at compile time as it would leave the schedule dangling
+ * Reference outside the table uses the first / last point
+ *
+ * Example:
+ * static constexpr std::array<GainPoint, 3> gainTable {{
+ *         {10.0f, 0.30f, 3.0f, 0.05f},
+ *         {50.0f, 0.20f, 2.0f, 0.08f},
+ *         {90.0f, 0.15f, 1.5f, 0.10f}}};
+ * constexpr GainSchedule schedule(gainTable);
+ */
+class GainSchedule {
+public:
+    constexpr GainSchedule() = default;
+    template<std::size_t N>
+    constexpr GainSchedule(const std::array<GainPoint, N>& points) : _points(points.data()), _size((uint8_t)N)
+    {
+        static_assert(N > 0 && N < 256, "Gain schedule needs 1 to 255 points");
+    }
+    template<std::size_t N>
+    GainSchedule(const std::array<GainPoint, N>&& points) = delete;
+
+    constexpr bool empty() const { return _size == 0; }
+
+    /** Interpolated gains at reference */
+    GainPoint lookup(float reference) const
+    {
+        // count points at or below reference instead of searching, table is short
+        uint8_t upper = 0;
+        for (uint8_t i = 0; i < _size; i++) upper += (reference >= _points[i].reference);
+        if (upper == 0) return _points[0];
+        if (upper == _size) return _points[_size - 1];
+
+        const GainPoint& a = _points[upper - 1];
+        const GainPoint& b = _points[upper];
+        float ratio = (reference - a.reference) / (b.reference - a.reference);
+        return GainPoint{reference,
+                         a.Kp + (b.Kp - a.Kp) * ratio,
+                         a.Ki + (b.Ki - a.Ki) * ratio,
+                         a.Kd + (b.Kd - a.Kd) * ratio};
+    }
+
+private:
+    const GainPoint* _points = nullptr;
+    uint8_t _size = 0;
+};
+
+#endif //GAINSCHEDULE_H
@@ -0,0 +1,99 @@
+#include "InterruptPulseCounter.h"
+
+InterruptPulseCounter::InterruptPulseCounter(PinName encoderA, PinName encoderB, EncodeType encodeType,
+        Timer* edgeTimer)
+        : _encoderAInterrupt(encoderA), _encoderBInterrupt(encoderB), _encodeType(encodeType), _edgeTimer(edgeTimer),
+          _decoder(edgeTimer != nullptr)
+{
+}
+
+void InterruptPulseCounter::start()
+{
+    _decoder.start(readState());
+    switch(_encodeType){
+    case EncodeType::X1:
+        _encoderAInterrupt.rise(callback(this, &InterruptPulseCounter::decodeEdgeA));
+        break;
+    case EncodeType::X2:
+        _encoderAInterrupt.rise(callback(this, &InterruptPulseCounter::decodeEdgeA));
+        _encoderAInterrupt.fall(callback(this, &InterruptPulseCounter::decodeEdgeA));
+        break;
+    case EncodeType::X4:
+        _encoderAInterrupt.rise(callback(this, &InterruptPulseCounter::decodeTransition));
+        _encoderAInterrupt.fall(callback(this, &InterruptPulseCounter::decodeTransition));
+        _encoderBInterrupt.rise(callback(this, &InterruptPulseCounter::decodeTransition));
+        _encoderBInterrupt.fall(callback(this, &InterruptPulseCounter::decodeTransition));
+        break;
+    }
+}
+
+void InterruptPulseCounter::stop()
+{
+    switch(_encodeType){
+    case EncodeType::X1:
+        _encoderAInterrupt.rise(NULL);
+        break;
+    case EncodeType::X2:
+        _encoderAInterrupt.rise(NULL);
+        _encoderAInterrupt.fall(NULL);
+        break;
+    case EncodeType::X4:
+        _encoderAInterrupt.rise(NULL);
+        _encoderAInterrupt.fall(NULL);
+        _encoderBInterrupt.rise(NULL);
+        _encoderBInterrupt.fall(NULL);
+        break;
+    }
+}
+
+long InterruptPulseCounter::takePulses()
+{
+    return _decoder.takePulses();
+}
+
+long InterruptPulseCounter::peekPulses() const
+{
+    return _decoder.peekPulses();
+}
+
+bool InterruptPulseCounter::armCompare(long compare, int8_t direction, CompareHandler handler, void* context)
+{
+    _decoder.armCompare(compare, direction, handler, context);
+    return true;
+}
+
+void InterruptPulseCounter::disarmCompare()
+{
+    _decoder.disarmCompare();
+}
+
+unsigned long InterruptPulseCounter::getInvalidTransitions() const
+{
+    return _decoder.getInvalidTransitions();
+}
+
+bool InterruptPulseCounter::hasEdgeTime() const
+{
+    return _decoder.hasEdgeTime();
+}
+
+PulseCounter::EdgeTime InterruptPulseCounter::getEdgeTime() const
+{
+    // from Ticker ISR encoder interrupts cannot preempt this, from thread see getEdgeSequence()
+    return _decoder.getEdgeTime();
+}
+
+uint32_t InterruptPulseCounter::getEdgeSequence() const
+{
+    return _decoder.getEdgeSequence();
+}
+
+void InterruptPulseCounter::decodeEdgeA()
+{
+    _decoder.decodeEdgeA(readState(), edgeTime());
+}
+
+void InterruptPulseCounter::decodeTransition()
+{
+    _decoder.decodeTransition(readState(), edgeTime());
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#ifndef INTERRUPTPULSECOUNTER_H
+#define INTERRUPTPULSECOUNTER_H
+
+#include <mbed.h>
+#include "PulseCounter.h"
+#include "QuadratureDecoder.h"
+
+/** Count encoder pulses with InterruptIn on encoder channel A and B
+ * Works on any interrupt capable pin, costs one ISR per counted edge
+ * Edges are decoded by QuadratureDecoder, see there for X1 / X2 / X4 decoding
+ * If edgeTimer is given, every counted edge is timestamped for period measurement
+ */
+class InterruptPulseCounter : public PulseCounter {
+public:
+    InterruptPulseCounter() = delete;
+    InterruptPulseCounter(PinName encoderA, PinName encoderB, EncodeType encodeType = EncodeType::X1,
+            Timer* edgeTimer = nullptr);
+
+    void start() override;
+    void stop() override;
+    long takePulses() override;
+    long peekPulses() const override;
+    bool armCompare(long compare, int8_t direction, CompareHandler handler, void* context) override;
+    void disarmCompare() override;
+    unsigned long getInvalidTransitions() const override;
+    bool hasEdgeTime() const override;
+    EdgeTime getEdgeTime() const override;
+    uint32_t getEdgeSequence() const override;
+
+private:
+    uint8_t readState(){
+        return (uint8_t)((_encoderAInterrupt.read() << 1) | _encoderBInterrupt.read());
+    }
+    unsigned long long edgeTime() {
+        return _edgeTimer != nullptr ? _edgeTimer->read_high_resolution_us() : 0;
+    }
+    void decodeEdgeA();                 // X1 and X2 edge handler
+    void decodeTransition();            // X4 edge handler
+
+    InterruptIn _encoderAInterrupt, _encoderBInterrupt;
+    EncodeType _encodeType;
+    Timer* _edgeTimer;
+    QuadratureDecoder _decoder;         // decoding, count, edge time and compare (mbed free)
+};
+
+#endif //INTERRUPTPULSECOUNTER_H
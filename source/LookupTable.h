@@ -0,0 +1,78 @@
+#pragma once
+
+#ifndef LOOKUPTABLE_H
+#define LOOKUPTABLE_H
+
+#include <array>
+#include <cstddef>
+
+/** Piecewise linear lookup table with fixed capacity (no heap)
+ * x must be strictly increasing, input outside the table is clamped to the first / last point
+ * Example: constexpr LookupTable<3> curve({0.0f, 50.0f, 100.0f}, {0.0f, 40.0f, 100.0f});
+ * @tparam N capacity, number of points in use can be less (see size())
+ */
+template<std::size_t N>
+class LookupTable {
+    static_assert(N >= 2, "Lookup table needs at least 2 points");
+public:
+    static constexpr std::size_t capacity = N;
+
+    constexpr LookupTable() = default;
+    constexpr LookupTable(const std::array<float, N>& x, const std::array<float, N>& y, std::size_t size = N)
+            : _x(x), _y(y), _size(size <= N ? size : N) {}
+
+    /** Set point i, points beyond size() extend the table */
+    void setPoint(std::size_t i, float x, float y)
+    {
+        if (i >= N) return;
+        _x[i] = x;
+        _y[i] = y;
+        if (i >= _size) _size = i + 1;
+    }
+    void clear() { _size = 0; }
+
+    constexpr std::size_t size() const { return _size; }
+    constexpr bool empty() const { return _size == 0; }
+    constexpr float x(std::size_t i) const { return _x[i]; }
+    constexpr float y(std::size_t i) const { return _y[i]; }
+
+    /** Check x strictly increasing and y non-decreasing */
+    bool isMonotone() const
+    {
+        for (std::size_t i = 1; i < _size; i++) {
+            if (_x[i] <= _x[i - 1] || _y[i] < _y[i - 1]) return false;
+        }
+        return true;
+    }
+
+    /** Interpolate y at x */
+    float interpolate(float x) const
+    {
+        if (_size == 0) return 0.0f;
+        if (x <= _x[0]) return _y[0];
+        std::size_t i = 1;
+        while (i < _size && x > _x[i]) i++;
+        if (i == _size) return _y[_size - 1];
+        return _y[i - 1] + (_y[i] - _y[i - 1]) * (x - _x[i - 1]) / (_x[i] - _x[i - 1]);
+    }
+
+    /** Find x at which interpolate(x) reaches y, table must be monotone
+     * flat segment returns its first x, input outside the table is clamped
+     */
+    float inverse(float y) const
+    {
+        if (_size == 0) return 0.0f;
+        if (y <= _y[0]) return _x[0];
+        std::size_t i = 1;
+        while (i < _size && y > _y[i]) i++;
+        if (i == _size) return _x[_size - 1];
+        return _x[i - 1] + (_x[i] - _x[i - 1]) * (y - _y[i - 1]) / (_y[i] - _y[i - 1]);
+    }
+
+private:
+    std::array<float, N> _x{};
+    std::array<float, N> _y{};
+    std::size_t _size = 0;
+};
+
+#endif //LOOKUPTABLE_H
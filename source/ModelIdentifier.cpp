@@ -0,0 +1,103 @@
+#include "ModelIdentifier.h"
+#include <cmath>
+
+namespace {
+const float initialCovariance = 1000.0f;
+const float maxCovarianceTrace = 10000.0f;     // stop forgetting above this, avoids wind-up without excitation
+const float errorFilterGain = 0.05f;
+const uint32_t minSamples = 20;
+}
+
+ModelIdentifier::ModelIdentifier(float forgetting)
+{
+    setForgetting(forgetting);
+    reset();
+}
+
+void ModelIdentifier::setForgetting(float forgetting)
+{
+    _forgetting = (forgetting > 0 && forgetting <= 1) ? forgetting : 1.0f;
+}
+
+void ModelIdentifier::reset()
+{
+    for (auto &estimator: _estimators) {
+        estimator.theta = {0.0f, 0.0f, 0.0f};
+        for (unsigned int i = 0; i < 3; i++) {
+            for (unsigned int j = 0; j < 3; j++) estimator.P[i][j] = i == j ? initialCovariance : 0.0f;
+        }
+        estimator.errorVariance = 0.0f;
+    }
+    _samples = 0;
+    _period = 0.0f;
+    hold();
+}
+
+void ModelIdentifier::hold()
+{
+    _history = 0;
+}
+
+void ModelIdentifier::update(float input, float output, uint32_t timeStep_us)
+{
+    for (unsigned int i = maxDelay; i > 0; i--) _inputs[i] = _inputs[i - 1];
+    _inputs[0] = input;
+
+    // candidate d needs output of previous period and input d periods before it
+    if (_history > 0) {
+        float period = timeStep_us * 1e-6f;
+        _period = _samples == 0 ? period : _period + errorFilterGain * (period - _period);
+        for (unsigned int d = 0; d <= maxDelay && d < _history; d++) step(_estimators[d], _inputs[d], output);
+        _samples++;
+    }
+    if (_history <= maxDelay) _history++;
+    _previousOutput = output;
+}
+
+void ModelIdentifier::step(ModelIdentifier::Estimator& estimator, float previousInput, float output)
+{
+    const float phi[3] = {_previousOutput, previousInput, 1.0f};
+    float Pphi[3];
+    float denominator = 0.0f;
+    float prediction = 0.0f;
+    float trace = 0.0f;
+    for (unsigned int i = 0; i < 3; i++) {
+        Pphi[i] = estimator.P[i][0] * phi[0] + estimator.P[i][1] * phi[1] + estimator.P[i][2] * phi[2];
+        prediction += estimator.theta[i] * phi[i];
+        trace += estimator.P[i][i];
+    }
+    float forgetting = trace < maxCovarianceTrace ? _forgetting : 1.0f;
+    for (unsigned int i = 0; i < 3; i++) denominator += phi[i] * Pphi[i];
+    denominator += forgetting;
+
+    float error = output - prediction;
+    estimator.errorVariance += errorFilterGain * (error * error - estimator.errorVariance);
+
+    // P is symmetric, so phi' * P = Pphi'
+    for (unsigned int i = 0; i < 3; i++) {
+        float gain = Pphi[i] / denominator;
+        estimator.theta[i] += gain * error;
+        for (unsigned int j = 0; j < 3; j++) estimator.P[i][j] = (estimator.P[i][j] - gain * Pphi[j]) / forgetting;
+    }
+}
+
+ModelIdentifier::Model ModelIdentifier::getModel() const
+{
+    Model model;
+    if (_samples < minSamples) return model;
+
+    unsigned int best = 0;
+    for (unsigned int d = 1; d <= maxDelay; d++) {
+        if (_estimators[d].errorVariance < _estimators[best].errorVariance) best = d;
+    }
+    const Estimator& estimator = _estimators[best];
+    float a = estimator.theta[0], b = estimator.theta[1], c = estimator.theta[2];
+    if (a <= 0 || a >= 1 || b <= 0) return model;      // not a stable first order lag
+
+    model.gain = b / (1 - a);
+    model.timeConstant = -_period / std::log(a);
+    model.delay = best * _period;
+    model.deadband = -c / b;
+    model.valid = true;
+    return model;
+}
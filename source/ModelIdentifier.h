@@ -0,0 +1,77 @@
+#pragma once
+
+#ifndef MODELIDENTIFIER_H
+#define MODELIDENTIFIER_H
+
+#include <array>
+#include <cstdint>
+
+/** Online identification of first order plus dead time (FOPDT) model by recursive least squares
+ * output = gain * (input - deadband) / (timeConstant * s + 1) * exp(-delay * s)
+ * Discretised at control period T as y[k] = a * y[k-1] + b * u[k-1-d] + c,
+ * one 3 parameter RLS runs for every delay candidate d = 0 .. maxDelay samples and
+ * the candidate with lowest prediction error gives the model
+ * Forgetting factor tracks slow drift (e.g. gearbox wear), covariance is bounded so that
+ * it does not wind up while the input is constant
+ * Free of mbed and heap, update() is called at control rate
+ *
+ * Example:
+ * ModelIdentifier identifier(0.99f);
+ * identifier.update(duty, speed, timeStep_us);   // input applied over last period, output measured at its end
+ * ModelIdentifier::Model model = identifier.getModel();
+ */
+class ModelIdentifier {
+public:
+    static constexpr unsigned int maxDelay = 4;     // longest delay candidate (samples)
+
+    struct Model {
+        float gain = 0.0f;          // output per input at steady state
+        float timeConstant = 0.0f;  // seconds
+        float delay = 0.0f;         // seconds, multiple of sample period
+        float deadband = 0.0f;      // input at which output starts to rise
+        bool valid = false;         // false until enough data or if estimate is not a stable FOPDT
+    };
+
+    explicit ModelIdentifier(float forgetting = 0.99f);
+
+    /** Add one sample
+     * @param input input applied over the last period
+     * @param output output measured at end of the last period
+     * @param timeStep_us length of the last period
+     */
+    void update(float input, float output, uint32_t timeStep_us);
+
+    /** Drop sample history but keep estimate, e.g. while motor is stopped and model does not hold */
+    void hold();
+
+    /** Restart estimation from scratch */
+    void reset();
+
+    /** Forgetting factor in (0, 1], lower tracks faster but is noisier, 1 never forgets */
+    void setForgetting(float forgetting);
+
+    /** Compute model from current estimate, not meant for control rate (uses log) */
+    Model getModel() const;
+
+    /** Period averaged from timeStep_us (s) */
+    float getSamplePeriod() const { return _period; }
+
+private:
+    struct Estimator {
+        std::array<float, 3> theta;             // a, b, c
+        std::array<std::array<float, 3>, 3> P;  // covariance
+        float errorVariance;                    // filtered squared prediction error
+    };
+
+    void step(Estimator& estimator, float previousInput, float output);
+
+    float _forgetting;
+    std::array<Estimator, maxDelay + 1> _estimators;
+    std::array<float, maxDelay + 1> _inputs{};     // _inputs[d] is input applied d periods before the last
+    float _previousOutput = 0.0f;
+    unsigned int _history = 0;                      // consecutive samples since hold()
+    uint32_t _samples = 0;                          // samples used since reset()
+    float _period = 0.0f;
+};
+
+#endif //MODELIDENTIFIER_H
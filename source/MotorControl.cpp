@@ -1,16 +1,18 @@
 #include "MotorControl.h"
 #include "EncodedMotor.h"
 #include "PIDcontrol.h"
-#include "MovingAverage.h"
-
-MovingAverage<float, 11> refSmoothing;
+#include <cmath>
 
 MotorControl::MotorControl(PinName motorEnable, PinName motorDirectionPin1, PinName motorDirectionPin2,
                            std::shared_ptr<EncodedMotor> &encodedMotor,
-                           float Kp, float Ki, float Kd, float ratedRPM) :
+                           float Kp, float Ki, float Kd, float ratedRPM, float pwmFrequency) :
 	_motorEnable(motorEnable), _motorDirectionPin1(motorDirectionPin1), _motorDirectionPin2(motorDirectionPin2), _encodedMotor(encodedMotor),
 	_piControl(std::make_unique<PIDcontrol>(Kp, Ki, Kd)), _ratedRPM(ratedRPM)
 {
+    _piControl->setOutputLimits(0.0f, 100.0f);      // set range of _compVolt to 0.0 - 100.0
+    setPwmFrequency(pwmFrequency);
+    _controlTimer.start();
+    setControlRate();
 	stop();     // make sure enable pin is LOW at initialize
     setDirection();
 }
@@ -23,20 +25,60 @@ bool MotorControl::run()
     updateSpeedData();
 	processInput();
     bool isSteady = false;
-    // run only if latest data (data at new timeStep) is provided
-	if (_thisTime > _prevTime)
+    // run only once per control tick
+	uint32_t tickCount, tickTime;
+	do {
+	    tickCount = _tickCount;
+	    tickTime = _tickTime;
+	} while (tickCount != _tickCount);      // retry if ticked while reading
+	if (tickCount != _prevTickCount)
 	{
-	    unsigned long long timeStep = _thisTime - _prevTime;	// unit us
-
-		// PI Controller
-		_compVolt += _piControl->compensateSignal(_adjErrorVolt, timeStep);
-        if(_compVolt > 100 ){_compVolt = 100.0f;}           // set range of _compVolt to 0.0 - 100.0
-        else if (_compVolt < 0.0f) {_compVolt = 0.0f;}
-
-
-        _motorEnable.write(_compVolt/100);    // output to Motor
-
-		_prevTime = _thisTime;		// update TimeStep
+	    unsigned long long timeStep = tickTime - _prevTime;	// unit us, measured control period
+	    if (_clearFaultRequested) {
+	        _clearFaultRequested = false;
+	        _stallDetector.clear();
+	    }
+	    bool faulted = _stallDetector.getFault() != Fault::None;
+	    stepReversal(tickTime);
+	    if (faulted) { _refVolt = 0; _profile.reset(0); }     // stay stopped until clearFault()
+	    stepMove(timeStep * 1e-6f);
+	    updateError(timeStep * 1e-6f);
+
+		// identify from output applied over last period, model only holds while motor is driven
+		if (_identify) {
+		    if (_dutyVolt > 0) _identifier.update(_dutyVolt, _speedVolt, (uint32_t)timeStep);
+		    else _identifier.hold();
+		}
+
+		// PI Controller, or relay while auto-tuning, output held at 0 while dwelling at reversal or faulted
+		if (_reversalState == ReversalState::Dwell || faulted) _compVolt = 0;
+		else if (_calibrator.isRunning()) runCalibration(tickTime);
+		else if (_autoTuner.isRunning()) runAutoTune(tickTime);
+		else {
+		    // feedforward from reference, PID output range shrinks so that total stays within 0 - 100
+		    _feedforwardVolt = _feedforward.interpolate(_profileVolt);
+		    if (!_feedforward.empty()) _piControl->setOutputLimits(-_feedforwardVolt, 100.0f - _feedforwardVolt);
+		    _piControl->scheduleGains(_profileVolt);
+		    _compVolt = _feedforwardVolt + _piControl->compensateSignal(_adjErrorVolt, _speedVolt, timeStep);     // limited by controller
+		}
+
+		// cut output in the same control period as stall is detected
+		float duty = limitStall(quantiseDuty(outputDuty()), tickTime);
+		bool tripped = !faulted && _stallDetector.getFault() != Fault::None;
+		if (tripped) {
+		    _compVolt = 0;
+		    _piControl->reset(0);
+		    if (_autoTuner.isRunning()) _autoTuner.abort();
+		    if (_calibrator.isRunning()) _calibrator.abort();
+		    _move.abort();
+		}
+
+        _dutyVolt = duty;
+        _motorEnable.write(_dutyVolt/100);    // output to Motor
+        if (tripped && _faultCallback) _faultCallback.call();
+
+		_prevTime = tickTime;		// update TimeStep
+		_prevTickCount = tickCount;
         isSteady = checkSteady();
 	}
 
@@ -45,7 +87,12 @@ bool MotorControl::run()
 
 void MotorControl::stop()
 {
+    if (_autoTuner.isRunning()) _autoTuner.abort();
+    if (_calibrator.isRunning()) _calibrator.abort();
+    _moveRequested = false;
+    _move.abort();
     _refVolt = 0;
+    _resumeRefVolt = 0;     // do not resume after pending reversal
     run();
 /*	_speedData = _encodedMotor->getSpeed();
 	_speed = std::get<0>(_speedData);			// get speed in RPM
@@ -70,7 +117,9 @@ void MotorControl::setDirection(MotorControl::Direction direction)
 }
 
 void MotorControl::setRefVolt(float refVolt) {
-    MotorControl::_refVolt = refVolt;
+    // during reversal the new reference is applied once direction has changed
+    if (_reversalState != ReversalState::None) _resumeRefVolt = refVolt;
+    else MotorControl::_refVolt = refVolt;
 }
 
 MotorControl::Direction MotorControl::getCurrentDirection() { return _motorCurrentDirection; }
@@ -82,45 +131,315 @@ void MotorControl::chgDirection() {
 }
 
 void MotorControl::updateSpeedData() {
-    _speedData = _encodedMotor->getSpeed();
-    _speed = (float)std::get<0>(_speedData);	// get speed in RPM
+    _speedData = _sampleTick ? _encodedMotor->getSample() : _encodedMotor->getLiveSample();
+    _speed = _speedData.speed;	// get speed in RPM
+    if (_motorCurrentDirection == Direction::C_Clockwise) _speed = -_speed;     // speed along current direction, negative if back-driven
     _speedVolt = _speed *100 / _ratedRPM;		// map rated RPM to 0 ~ 100
-    _thisTime = std::get<1>(_speedData);		// get current timeStep (us)
 }
 
 void MotorControl::processInput() {
     /** Change Motor Direction
-     * Check refVolt for positive (CW) / negative value (CCW)
-     * Only change motor direction when _compVolt = 0 (i.e. at full stop)
-     * If _setMotorDirection changed during operation, stop the motor (i.e. set refVolt = 0)
+     * If _setMotorDirection changed during operation, start reversal (see stepReversal)
+     * reference is kept to resume in new direction
      */
-    if (_motorCurrentDirection != _motorSetDirection){
-        if (_compVolt == 0) {
-            _motorCurrentDirection = _motorSetDirection;
-            setDirection(_motorCurrentDirection);
-        }
-        else {_refVolt = 0; }
+    if (_motorCurrentDirection != _motorSetDirection && _reversalState == ReversalState::None) {
+        if (_autoTuner.isRunning()) _autoTuner.abort();
+        _moveRequested = false;
+        _move.abort();
+        _resumeRefVolt = _refVolt;
+        _reversalState = ReversalState::Decelerating;
     }
+}
+
+void MotorControl::stepReversal(uint32_t time) {
+    /** Reverse motor direction
+     * Decelerating: slow down along speed profile, switch direction pins once profile and measured speed
+     *               are within zeroSpeedCriteria (i.e. at full stop)
+     * Dwell: hold output at 0 for reversal dwell time, then resume reference (ReversalMode::Resume)
+     *        or stay stopped (ReversalMode::Stop)
+     */
+    const float zeroSpeedCriteria = 0.5f;       // speed within 0.5% of rated RPM is treated as stopped
+    switch (_reversalState) {
+        case ReversalState::Decelerating:
+            if (_motorCurrentDirection == _motorSetDirection) {
+                // flipped back before stop, carry on in current direction
+                _reversalState = ReversalState::None;
+                _refVolt = _resumeRefVolt;
+                break;
+            }
+            _refVolt = 0;
+            if (_profileVolt == 0 && std::abs(_speedVolt) < zeroSpeedCriteria) {
+                _compVolt = 0;
+                _dutyVolt = 0;
+                _motorEnable.write(0);
+                _motorCurrentDirection = _motorSetDirection;
+                setDirection(_motorCurrentDirection);
+                _piControl->reset(0);
+                _reversalTime = time;
+                _reversalState = ReversalState::Dwell;
+            }
+            break;
+        case ReversalState::Dwell:
+            _refVolt = 0;
+            if (time - _reversalTime >= _reversalDwell_us) {
+                _reversalState = ReversalState::None;
+                if (_reversalMode == ReversalMode::Resume) _refVolt = _resumeRefVolt;
+            }
+            break;
+        default:
+            break;
+    }
+}
 
-    /** Saturate error voltage to factor
-    * speed up motor gradually by factor set in MotorControl.h
-    * default factor is 2V / s (0.02f per 100ms, refresh rate)
-    * _errorVolt signal pull down to 0 at -0.4 ~ 0.4
+void MotorControl::updateError(float timeStep_s) {
+    /** Track speed profile
+    * profile moves toward reference within acceleration and jerk limits (see setAccelerationLimits)
+    * _errorVolt signal pull down to 0 at -0.1 ~ 0.1
     */
-    _errorVolt = _refVolt * 100 - _speedVolt;
+    const float maxProfileStep = 1.0f;      // first tick after start measures time since construction
+    _profileVolt = _profile.update(_refVolt * 100, timeStep_s < maxProfileStep ? timeStep_s : maxProfileStep);
+    _errorVolt = _profileVolt - _speedVolt;
 
-    if (_errorVolt > 2) _adjErrorVolt = 2;
-    else if (_errorVolt < -2) _adjErrorVolt = -2;
-    else if (_errorVolt < 0.1 && _errorVolt > -0.1) _adjErrorVolt = 0;
+    if (_errorVolt < 0.1 && _errorVolt > -0.1) _adjErrorVolt = 0;
     else _adjErrorVolt = _errorVolt;
 }
 
+void MotorControl::setControlRate(float controlRate) {
+    _controlTicker.detach();
+    _encodedMotor->attachSampleCallback(NULL);
+    if (controlRate > 1000) controlRate = 1000;
+    if (_encodedMotor->getEstimator() == SpeedEstimator::PulseCount && controlRate > _encodedMotor->getSamplingRate())
+        controlRate = _encodedMotor->getSamplingRate();
+    _sampleTick = controlRate <= 0;
+
+    if (controlRate > 0) _controlTicker.attach(callback(this, &MotorControl::controlTick), 1/controlRate);
+    else _encodedMotor->attachSampleCallback(callback(this, &MotorControl::controlTick));
+}
+
+void MotorControl::useExternalTick() {
+    _controlTicker.detach();
+    _encodedMotor->attachSampleCallback(NULL);
+    _sampleTick = false;
+}
+
+void MotorControl::tick() { controlTick(); }
+
+void MotorControl::attachControlCallback(Callback<void()> func) {
+    // controlTick() may call the callback from ISR, never let it see a half written one
+    core_util_critical_section_enter();
+    _controlCallback = func;
+    core_util_critical_section_exit();
+}
+
+void MotorControl::controlTick() {
+    _tickTime = (uint32_t)_controlTimer.read_high_resolution_us();
+    _tickCount = _tickCount + 1;
+    if (_controlCallback) _controlCallback.call();
+}
+
+void MotorControl::setControlForm(PIDcontrol::Form form) { _piControl->setForm(form); }
+
+void MotorControl::setAntiWindup(PIDcontrol::AntiWindup antiWindup, float trackingGain) {
+    _piControl->setAntiWindup(antiWindup, trackingGain);
+}
+
+void MotorControl::setSlewLimit(float slewRate) { _piControl->setSlewLimit(slewRate); }
+
+void MotorControl::startAutoTune(float refVolt, float relayAmplitude, RelayAutoTuner::TuningRule rule) {
+    _refVolt = refVolt;
+    _autoTuner.startWithin(refVolt * 100, relayAmplitude, 0.0f, 100.0f, 0.5f, 4, rule);
+}
+
+void MotorControl::runAutoTune(uint32_t time) {
+    _compVolt = _autoTuner.update(_speedVolt, time, *_piControl, _feedforward.interpolate(_profileVolt));
+}
+
+bool MotorControl::setFeedforward(const MotorControl::FeedforwardTable& table) {
+    if (!table.isMonotone()) return false;
+    _feedforward = table;
+    if (_feedforward.empty()) _piControl->setOutputLimits(0.0f, 100.0f);
+    return true;
+}
+
+void MotorControl::setFeedforward(float deadband, float slope) {
+    // straight line above deadband sampled into the table, step to deadband at 1% of rated RPM
+    FeedforwardTable table;
+    table.setPoint(0, 0.0f, 0.0f);
+    for (unsigned int i = 1; i < 9; i++) {
+        float reference = i == 1 ? 1.0f : 100.0f * (i - 1) / 7;
+        float volt = deadband + slope * reference;
+        table.setPoint(i, reference, volt > 100.0f ? 100.0f : volt);
+    }
+    setFeedforward(table);
+}
+
+float MotorControl::readFeedforward() const { return _feedforwardVolt; }
+
+void MotorControl::setIdentification(bool enable, float forgetting) {
+    if (enable && !_identify) _identifier.reset();
+    _identifier.setForgetting(forgetting);
+    _identify = enable;
+}
+
+ModelIdentifier::Model MotorControl::readModel() const { return _identifier.getModel(); }
+
+void MotorControl::stepMove(float timeStep_s) {
+    /** Position loop
+     * speed reference = planned speed + positionGain * (planned position - travel)
+     * move ends once plan is finished and travel is within positionTolerance of target (or beyond it)
+     */
+    const float positionTolerance = 0.2f;           // mm
+    float speedPerVolt = _ratedRPM / 60 * _encodedMotor->getTravelPerRotation() / 100;     // mm/s per speed volt
+    if (_moveRequested) {
+        // take request as a whole, startMove() may run in between from ISR
+        core_util_critical_section_enter();
+        float distance = _moveDistance, refVolt = _moveRefVolt;
+        _moveRequested = false;
+        core_util_critical_section_exit();
+        float acceleration = _profile.getMaxAcceleration() > 0 ? _profile.getMaxAcceleration() : 100.0f;
+        if (_stallDetector.getFault() != Fault::None || speedPerVolt <= 0
+            || !_move.start(distance, refVolt * 100 * speedPerVolt, acceleration * speedPerVolt)) return;
+        _moveStart = _speedData.position;
+        _travel = 0;
+    }
+    if (!_move.isRunning()) return;
+
+    int64_t pulses = _speedData.position - _moveStart;
+    if (_motorCurrentDirection == Direction::C_Clockwise) pulses = -pulses;
+    _travel = _encodedMotor->pulsesToMillimetres(pulses);
+    _move.update(timeStep_s);
+
+    float positionError = _move.getPosition() - _travel;
+    float speed = _move.getSpeed() + _positionGain * positionError;
+    if (_move.isFinished() && positionError < positionTolerance) {
+        _move.abort();
+        speed = 0;
+    }
+    if (speed < 0) speed = 0;           // never reverse to correct overshoot
+    _refVolt = speed / speedPerVolt / 100;
+    if (_refVolt > 1) _refVolt = 1;
+    _profile.reset(_refVolt * 100);     // move is already shaped, speed loop follows position loop directly
+}
+
+void MotorControl::setTravelPerRotation(float travelPerRotation) {
+    _encodedMotor->setTravelPerRotation(travelPerRotation);
+}
+
+void MotorControl::setPositionGain(float positionGain) { _positionGain = positionGain; }
+
+void MotorControl::startMove(float distance, float refVolt) {
+    // publish distance and speed together with the flag, run() never sees a half written request
+    core_util_critical_section_enter();
+    _moveDistance = distance;
+    _moveRefVolt = refVolt;
+    _moveRequested = true;
+    core_util_critical_section_exit();
+}
+
+bool MotorControl::isMoving() const { return _moveRequested || _move.isRunning(); }
+
+float MotorControl::readTravel() const { return _travel; }
+
+void MotorControl::setAccelerationLimits(float maxAcceleration, float maxJerk) {
+    _profile.setLimits(maxAcceleration, maxJerk);
+}
+
+float MotorControl::readProfile() const { return _profileVolt; }
+
+void MotorControl::setReversal(MotorControl::ReversalMode mode, float dwellTime) {
+    _reversalMode = mode;
+    _reversalDwell_us = dwellTime > 0 ? (uint32_t)(dwellTime * 1000000) : 0;
+}
+
+bool MotorControl::isReversing() const { return _reversalState != ReversalState::None; }
+
+float MotorControl::quantiseDuty(float duty) const {
+    // round to whole timer steps so written duty is exactly what the timer produces
+    return std::floor(duty / 100 * _dutySteps + 0.5f) * 100 / _dutySteps;
+}
+
+void MotorControl::setPwmFrequency(float pwmFrequency) {
+    _dutySteps = _motorEnable.setFrequency(pwmFrequency);
+    _dutyVolt = quantiseDuty(_dutyVolt);
+    _motorEnable.write(_dutyVolt/100);
+}
+
+unsigned int MotorControl::getDutySteps() const { return _dutySteps; }
+
+float MotorControl::getDutyResolution() const { return 100.0f / _dutySteps; }
+
+float MotorControl::readDuty() const { return _dutyVolt; }
+
+float MotorControl::outputDuty() const {
+    // _compVolt is linear in speed, map to duty giving that fraction of full speed
+    if (_linearisation.empty() || _calibrator.isRunning()) return _compVolt;
+    return _linearisation.inverse(_compVolt / 100 * _linearisation.y(_linearisation.size() - 1));
+}
+
+void MotorControl::runCalibration(uint32_t time) {
+    _compVolt = _calibrator.update(_speedVolt, time);
+    if (_calibrator.isRunning()) return;
+    if (_calibrator.isFinished()) setLinearisation(_calibrator.getTable());
+    // calibration ends at full duty, slow down along profile from current speed
+    _refVolt = 0;
+    _profile.reset(_speedVolt);
+    _compVolt = 0;
+    _piControl->reset(0);
+}
+
+void MotorControl::startCalibration(float settleTime) {
+    if (_autoTuner.isRunning()) _autoTuner.abort();
+    _calibrator.start((uint32_t)(settleTime * 1000000));
+}
+
+bool MotorControl::isCalibrating() const { return _calibrator.isRunning(); }
+
+bool MotorControl::setLinearisation(const LinearisationTable& table) {
+    if (!table.isMonotone()) return false;
+    if (!table.empty() && table.y(table.size() - 1) <= 0) return false;
+    _linearisation = table;
+    return true;
+}
+
+const MotorControl::LinearisationTable& MotorControl::readLinearisation() const { return _linearisation; }
+
+float MotorControl::limitStall(float duty, uint32_t time) {
+    auto sinceEdge = (uint32_t)(_speedData.time - _speedData.lastEdge);
+    return _stallDetector.limit(duty, StallDetector::expectedSpeed(duty, _linearisation, _feedforward), _speedVolt,
+                                time, sinceEdge);
+}
+
+void MotorControl::setStallDetection(float minDuty, float speedRatio, float overloadTime, float edgeTimeout) {
+    _stallDetector.setThresholds(minDuty, speedRatio, (uint32_t)(overloadTime * 1000000),
+                                 (uint32_t)(edgeTimeout * 1000000));
+}
+
+void MotorControl::attachFaultCallback(Callback<void()> func) { _faultCallback = func; }
+
+MotorControl::Fault MotorControl::getFault() const { return _stallDetector.getFault(); }
+
+void MotorControl::clearFault() { _clearFaultRequested = true; }
+
+void MotorControl::setGainSchedule(const GainSchedule& schedule) { _piControl->setGainSchedule(schedule); }
+
+RelayAutoTuner::State MotorControl::getAutoTuneState() const { return _autoTuner.getState(); }
+
+bool MotorControl::isAutoTuning() const { return _autoTuner.isRunning(); }
+
+float MotorControl::readKp() const { return _piControl->getKp(); }
+
+float MotorControl::readKi() const { return _piControl->getKi(); }
+
+float MotorControl::readKd() const { return _piControl->getKd(); }
+
 void MotorControl::setRatedRPM(float ratedRPM) { _ratedRPM = ratedRPM;}
 
 void MotorControl::setSteadyCriteria(unsigned int continuousSteadyCriteria) {
     MotorControl::_continuousSteadyCriteria = continuousSteadyCriteria;
 }
 
+void MotorControl::setSteadyTolerance(float tolerance) { _steadyDetector.setTolerance(tolerance); }
+
 float MotorControl::readComp() { return _compVolt; }
 
 float MotorControl::readSpeed() { return _speedVolt;  }
@@ -133,14 +452,12 @@ float MotorControl::readRefRPM() const {
     return _refVolt*_ratedRPM;
 }
 bool MotorControl::checkSteady() {
-    const float steadyStateCriteria = 12;           // steady state fluctuation within 0.001
-
-    // increase steady count if fluctuation limit reached... reset if out of range
-//    (abs(powerSmooth.getValue() - _prevPower) < steadyStateCriteria) ? steadyCount += 1 : steadyCount = 0;
-    (abs(_compVolt - _prevPower) < steadyStateCriteria) ? steadyCount += 1 : steadyCount = 0;
-
+    // speed error statistics over window, only meaningful once profile has reached reference
+    bool steady = _steadyDetector.addSample(_errorVolt) && _profile.isSettled()
+                  && _reversalState == ReversalState::None;
 
-    _prevPower = _compVolt;        // update _prevPower for next use
+    // increase steady count if criteria met... reset if out of range
+    steady ? steadyCount += 1 : steadyCount = 0;
 
     if (steadyCount >= _continuousSteadyCriteria && _compVolt<99.99) return true;
     else return false;
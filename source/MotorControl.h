@@ -6,46 +6,69 @@
 #include <mbed.h>
 #include <tuple>
 #include <memory>
-
-class EncodedMotor; 
-class PIDcontrol;
+#include "EncodedMotor.h"
+#include "PIDcontrol.h"
+#include "RelayAutoTuner.h"
+#include "LookupTable.h"
+#include "ModelIdentifier.h"
+#include "TrajectoryGenerator.h"
+#include "SteadyStateDetector.h"
+#include "DutyCalibrator.h"
+#include "TrapezoidalMove.h"
+#include "StallDetector.h"
+#include "TimerPwmOut.h"
 
 /** Motor Controller with PI Control
 * run(*) and stop() method must be placed in continuous loop
+* control step is executed at every control tick, i.e. new encoder sample (default) or fixed control rate
+* use attachControlCallback() to wake the loop at every control tick
 */
 class MotorControl {
 public:
+    /** Static curve of reference (0 - 100 of rated RPM) to _compVolt (0 - 100) */
+    using FeedforwardTable = LookupTable<9>;
+    /** Measured curve of duty (0 - 100) to speed, see DutyCalibrator */
+    using LinearisationTable = DutyCalibrator::Table;
+
 	MotorControl() = delete;
 	MotorControl(PinName motorEnablePwmPin, PinName motorDirectionPin1, PinName motorDirectionPin2,
                  std::shared_ptr<EncodedMotor> &encodedMotor,
-                 float Kp = 1, float Ki = 0, float Kd = 0, float ratedRPM = 24);
+                 float Kp = 1, float Ki = 0, float Kd = 0, float ratedRPM = 24, float pwmFrequency = 10000);
 	~MotorControl();
+	/** Clockwise is the direction with positive EncodedMotor speed */
 	enum class Direction {Clockwise = 0, C_Clockwise};
+	/** Behaviour after reversal, Stop waits for new reference, Resume ramps back to previous reference */
+	enum class ReversalMode {Stop = 0, Resume};
+	/** Fault latched by stall detection, Stall: no encoder edge, Overload: speed too low for duty */
+	using Fault = StallDetector::Fault;
 
 	/** start motor
-	* start motor gradually by factor set in MotorControl.h
-	* default factor is 2V / s
-	* max volt per step at 1.2V (0.1f)
-	* start from 1V (PwmOut 0.1f)
+	* speed follows jerk limited profile toward reference (see setAccelerationLimits)
 	* input reference power for power (MotorControl will adjust motor to actual power)
 	* return true if in steady
 	*/
     bool run();
 	
 	/** Stop motor
-	* slow down motor gradually by factor set in MotorControl.h
-	* default factor is 2V / s (0.02f per 100ms)
-	* cut off at 1V (analogRead 0.1f)
+	* slow down motor along the same profile as run()
 	*/
 	void stop();
 
 	/** Flip direction of motor
-	 * Motor rotating direction will not change immediately
+	 * Motor rotating direction will not change immediately, motor decelerates along speed profile,
+	 * direction pins are switched at measured zero speed, then reversal mode applies (see setReversal)
 	 * If pressed twice, the set direction will be flipped twice, hence rotating direction will not change
 	 * Default direction is clockwise
 	 */
 	void chgDirection();
 
+	/** Set behaviour of direction reversal
+	 * @param mode default is Stop
+	 * @param dwellTime time at standstill before ramping in new direction (s), default is 0.2 s
+	 */
+	void setReversal(ReversalMode mode, float dwellTime = 0.2f);
+	bool isReversing() const;       // return true from chgDirection() until dwell is over
+
 	/** Get the current direction of motor
 	 * Not necessary the direction set for direction of motor
 	 * (i.e. pending changes)
@@ -60,11 +83,176 @@ public:
      */
     void setRatedRPM(float ratedRPM = 24);
 
-    /** Set continuous steady criteria met (within 0.01 out of 1) to declare motor in steady state
+    /** Set continuous steady criteria met to declare motor in steady state
+     * criteria is checked over last steadyWindow speed errors (see SteadyStateDetector) after profile reached reference
      * @param continuousSteadyCriteria
-     * default is 5
+     * default is 1, i.e. steady as soon as a full window is within tolerance
+     */
+    void setSteadyCriteria(unsigned int continuousSteadyCriteria = 1);
+
+    /** Set tolerance band of speed error for steady state
+     * @param tolerance in 0 - 100 of rated RPM, default is 2
+     */
+    void setSteadyTolerance(float tolerance = 2.0f);
+
+    /** Set control rate independent of encoder sampling rate
+     * Speed at every control tick is estimated from the latest encoder edges (EncodedMotor::getLiveSample())
+     * PulseCount estimator has no estimate between samples, control rate is then limited to sampling rate
+     * (set sampling rate first), so no control step or model update runs on a repeated speed
+     * Control step uses measured period between ticks
+     * @param controlRate control rate in Hz (max 1000), 0 to run at every new encoder sample (default)
+     */
+    void setControlRate(float controlRate = 0);
+
+    /** Stop internal control tick, control steps only on tick(), e.g. shared timebase of MotorCoordinator
+     * setControlRate() returns to internal tick
+     */
+    void useExternalTick();
+
+    /** Advance control tick from external timebase, ISR safe */
+    void tick();
+
+    /** Attach function called from ISR at every control tick, safe while control tick is running
+     * @param func callback, e.g. set EventFlags to wake the control loop
+     */
+    void attachControlCallback(Callback<void()> func);
+
+    /** Set PWM frequency of motor enable pin
+     * Duty resolution is one timer step, see TimerPwmOut: on PA_15 TIM2 counts at 100 MHz
+     * (10 kHz: 10000 steps, 20 kHz: 5000 steps), other pins count 1 us (10 kHz: 100 steps)
+     * Higher frequency reduces current ripple and audible noise, written duty is rounded to the nearest step
+     * @param pwmFrequency in Hz, default is 10 kHz
+     */
+    void setPwmFrequency(float pwmFrequency = 10000);
+    unsigned int getDutySteps() const;  // return number of duty steps per PWM period
+    float getDutyResolution() const;    // return smallest duty change in 0 - 100
+    float readDuty() const;             // return duty written to motor (0 - 100)
+
+    /** Select PID form, default is Positional */
+    void setControlForm(PIDcontrol::Form form);
+
+    /** Select anti-windup of Positional form, default is BackCalculation
+     * @param trackingGain back calculation gain (1/s), 0 to use Ki / Kp
+     */
+    void setAntiWindup(PIDcontrol::AntiWindup antiWindup, float trackingGain = 0);
+
+    /** Set travel of carriage per rotation of output shaft, required by startMove()
+     * Also sets the drive ratio of encoder position, see EncodedMotor::getPositionMillimetres()
+     * @param travelPerRotation in mm, 0 if unknown (default)
+     */
+    void setTravelPerRotation(float travelPerRotation);
+
+    /** Set gain of position loop, speed correction (mm/s) per mm of position error
+     * @param positionGain in 1/s, default is 2
+     */
+    void setPositionGain(float positionGain = 2.0f);
+
+    /** Move distance along current direction and stop on target, ISR safe
+     * Trapezoidal move at refVolt with acceleration of setAccelerationLimits() is tracked by position loop,
+     * output of position loop is the reference of speed loop. Aborted by stop(), chgDirection() or fault
+     * Ignored if travel per rotation is not set
+     * @param distance travel in mm
+     * @param refVolt cruise speed, mapped 0.0 - 1.0 of rated RPM
      */
-    void setSteadyCriteria(unsigned int continuousSteadyCriteria = 5);
+    void startMove(float distance, float refVolt);
+    bool isMoving() const;
+    float readTravel() const;           // return mm travelled since start of latest move
+
+    /** Shape speed setpoint as S-curve from reference
+     * @param maxAcceleration speed change per second in 0 - 100 of rated RPM, 0 to step to reference
+     * @param maxJerk acceleration change per second, 0 for linear ramp
+     * default is 20 / s and 100 / s^2
+     */
+    void setAccelerationLimits(float maxAcceleration = 20.0f, float maxJerk = 100.0f);
+    float readProfile() const;          // return speed setpoint from profile (0 - 100)
+
+    /** Limit change of output (_compVolt) per second, 0 to disable (default) */
+    void setSlewLimit(float slewRate = 0);
+
+    /** Auto-tune PID gains by relay feedback around refVolt
+     * Motor is driven between (refVolt * 100) +/- relayAmplitude until the limit cycle is measured,
+     * computed gains are then applied and normal control resumes from the current output
+     * Tuning is aborted by stop()
+     * @param refVolt setpoint, mapped 0.0 - 1.0 of rated RPM
+     * @param relayAmplitude relay step in _compVolt unit (0 - 100)
+     * @param rule tuning rule
+     */
+    void startAutoTune(float refVolt, float relayAmplitude = 20.0f,
+                       RelayAutoTuner::TuningRule rule = RelayAutoTuner::TuningRule::ZieglerNichols);
+    RelayAutoTuner::State getAutoTuneState() const;
+    bool isAutoTuning() const;
+
+    /** Schedule PID gains by reference speed (GainPoint::reference in 0 - 100 of rated RPM)
+     * Gains are interpolated at every control step with bumpless transfer
+     * Finished auto-tune replaces the schedule with the tuned gains
+     */
+    void setGainSchedule(const GainSchedule& schedule);
+
+    /** Enable feedforward from reference speed, PID only corrects the residual
+     * @param table calibrated curve, must be monotone, empty table to disable (default)
+     * @return false if table is rejected
+     */
+    bool setFeedforward(const FeedforwardTable& table);
+
+    /** Enable feedforward from deadband and slope
+     * _compVolt = deadband + slope * reference for reference > 0, 0 otherwise
+     * @param deadband _compVolt at which motor starts to move
+     * @param slope _compVolt per reference above deadband
+     */
+    void setFeedforward(float deadband, float slope);
+    float readFeedforward() const;      // return feedforward part of compensate voltage
+
+    /** Linearise output with measured duty to speed curve
+     * _compVolt becomes fraction of full speed, written duty is the inverse of the curve at that speed,
+     * i.e. deadband is skipped and plant is near linear
+     * @param table monotone curve, e.g. from startCalibration() or CalibrationStore, empty table to disable (default)
+     * @return false if table is rejected
+     */
+    bool setLinearisation(const LinearisationTable& table);
+    const LinearisationTable& readLinearisation() const;
+
+    /** Measure duty to speed curve by sweeping duty, motor runs up to full speed
+     * Curve is applied by setLinearisation() when finished, aborted by stop()
+     * @param settleTime hold time at every duty step (s)
+     */
+    void startCalibration(float settleTime = 1.0f);
+    bool isCalibrating() const;
+
+    /** Identify FOPDT model of motor (duty to speed, both 0 - 100) during normal operation
+     * Runs recursive least squares on written duty (not _compVolt, which is linearised) while motor is driven
+     * @param enable default is disabled
+     * @param forgetting RLS forgetting factor, see ModelIdentifier
+     */
+    void setIdentification(bool enable, float forgetting = 0.99f);
+    ModelIdentifier::Model readModel() const;   // return identified model, check Model::valid
+
+    /** Detect stall by comparing duty written to motor with speed it should give, see StallDetector
+     * Expected speed is taken from linearisation curve, else inverse of feedforward curve. Detection stays
+     * inactive until one of them is set, e.g. from calibration, as the deadband of the motor is not known before
+     * On stall output is cut within the control period, fault is latched and fault callback is called,
+     * motor stays stopped until clearFault()
+     * @param minDuty duty (0 - 100) from which motor has to turn, 0 to disable
+     * @param speedRatio fraction of expected speed below which motor is overloaded
+     * @param overloadTime time below speedRatio of expected speed before Overload (s)
+     * @param edgeTimeout time without encoder edge before Stall (s)
+     * default is 20, 0.25, 1 s and 0.3 s
+     */
+    void setStallDetection(float minDuty = 20.0f, float speedRatio = 0.25f, float overloadTime = 1.0f,
+                           float edgeTimeout = 0.3f);
+
+    /** Attach function called from run() when a fault is latched, e.g. to turn off torch
+     * @param func callback, NULL to detach
+     */
+    void attachFaultCallback(Callback<void()> func);
+    Fault getFault() const;
+
+    /** Release latched fault at next control tick, safe to call from ISR */
+    void clearFault();
+
+    /** Read gains in use, e.g. after auto-tune */
+    float readKp() const;
+    float readKi() const;
+    float readKd() const;
     void setRefVolt(float _refVolt);
 
 	float readComp();       // return compensate voltage
@@ -78,11 +266,18 @@ protected:
 
 private:
 	// define Port
-    PwmOut _motorEnable;
+    TimerPwmOut _motorEnable;
     DigitalOut _motorDirectionPin1;
     DigitalOut _motorDirectionPin2;
 	std::shared_ptr<EncodedMotor> _encodedMotor;
 	std::unique_ptr<PIDcontrol> _piControl;
+	RelayAutoTuner _autoTuner;
+	DutyCalibrator _calibrator;
+	LinearisationTable _linearisation;
+	unsigned int _dutySteps = 20000;    // timer steps per PWM period (mbed default 20 ms at 1 us)
+	float _dutyVolt = 0.0f;             // duty written to motor, quantised
+	ModelIdentifier _identifier;
+	bool _identify = false;
 
 	// define Constant
 	float _ratedRPM = 0;
@@ -90,22 +285,55 @@ private:
 	float _adjErrorVolt = 0.0f;	    // step up output by 100 for comparison control
 	float _errorVolt = 0.0f;	    // step up output by 100 for comparison control
 	float _compVolt = 0.0f;		    // step up output by 100 for comparison control
+	float _feedforwardVolt = 0.0f;      // feedforward part of _compVolt
+	FeedforwardTable _feedforward;
+	TrajectoryGenerator _profile{20.0f, 100.0f};
+	float _profileVolt = 0.0f;          // speed setpoint from profile
+	enum class ReversalState : uint8_t {None, Decelerating, Dwell};
+	ReversalState _reversalState = ReversalState::None;
+	ReversalMode _reversalMode = ReversalMode::Stop;
+	uint32_t _reversalDwell_us = 200000;
+	uint32_t _reversalTime = 0;         // time direction pins were switched (us)
+	float _resumeRefVolt = 0.0f;        // reference to resume after reversal
+	volatile bool _clearFaultRequested = false;
+	Callback<void()> _faultCallback;
+	StallDetector _stallDetector;
+	TrapezoidalMove _move;
+	float _positionGain = 2.0f;         // 1/s
+	int64_t _moveStart = 0;             // encoder position at start of move
+	float _travel = 0.0f;               // mm along current direction since start of move
+	volatile bool _moveRequested = false;
+	float _moveDistance = 0.0f;         // requested move, planned at next control tick
+	float _moveRefVolt = 0.0f;
     float _refVolt = 0.0f;          // mapped to -1.0 to 1.0
-	std::tuple<double, unsigned long long> _speedData;
+	SpeedSample _speedData;
 	float _speed = 0.0f;
-	unsigned long long _thisTime = 0;
-	unsigned long long _prevTime = 0;
-	float _prevPower = 0.0f;
-	// record previous write power
+	Ticker _controlTicker;
+	Timer _controlTimer;
+	Callback<void()> _controlCallback;
+	volatile uint32_t _tickCount = 0;   // incremented at every control tick
+	volatile uint32_t _tickTime = 0;    // time of latest control tick (us)
+	bool _sampleTick = true;            // ticked by new encoder sample, else speed is estimated at tick
+	uint32_t _prevTickCount = 0;        // tick count of last control step
+	uint32_t _prevTime = 0;
+	static const int steadyWindow = 8;  // speed error samples checked for steady state
+	SteadyStateDetector<steadyWindow> _steadyDetector{2.0f};
 	unsigned int steadyCount = 0;
     // count number of continued steady state
-    unsigned int _continuousSteadyCriteria = 5;    // set continuous steady criteria met before steady state is declared
-
-    const unsigned int factor = 2;  	// Volt per 0.1s
+    unsigned int _continuousSteadyCriteria = 1;    // set continuous steady criteria met before steady state is declared
 
 	// define function and object
+	void controlTick();                 // ISR at every control tick
+	void runAutoTune(uint32_t time);    // Function to step relay auto-tune
+	void runCalibration(uint32_t time); // Function to step duty calibration sweep
+	float outputDuty() const;           // Function to map _compVolt to PWM duty (0 - 100)
+	float quantiseDuty(float duty) const;   // Function to round duty to PWM resolution
 	void updateSpeedData();             // Function to handle updating current speed data
 	void processInput();                // Function to handle input signal processing
+	void updateError(float timeStep_s); // Function to step speed profile and compute error
+	void stepReversal(uint32_t time);   // Function to step direction reversal
+	float limitStall(float duty, uint32_t time);    // Function to detect stall at duty about to be written, 0 on fault
+	void stepMove(float timeStep_s);    // Function to step position loop of move
     void setDirection(Direction direction = MotorControl::Direction::Clockwise);     // Private function to change direction of motor directly without safeguard
 	bool checkSteady();                 // Function to check if motor reach steady state
     Direction _motorCurrentDirection = Direction::Clockwise;   // Current Direction of Motor
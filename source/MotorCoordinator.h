@@ -0,0 +1,225 @@
+#pragma once
+
+#ifndef MOTORCOORDINATOR_H
+#define MOTORCOORDINATOR_H
+
+#include <mbed.h>
+#include <array>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include "EncodedMotor.h"
+#include "MotorControl.h"
+
+/** Run control loops of up to N motor axes from one timebase
+ * Every axis keeps its encoder, controller and reference together in one Axis entry, constructed in place
+ * in the coordinator, so per-axis state of all axes lies in one contiguous block
+ * A single Ticker ticks all controllers at the same time and run() steps all axes in one pass,
+ * so loop time grows linearly with number of axes (see getPassCycles() and measureCoordinatorCycles())
+ * start() and stop() apply to all axes at the same control tick, a fault of any axis stops all axes
+ * in the pass it is detected
+ *
+ * Example:
+ * MotorCoordinator<2> axes(10.0f);
+ * axes.addAxis(std::make_tuple(PA_9, PA_8, 1848*4*50, 10.0f), PA_15, PA_14, PA_13, 0.2f, 2.0f, 0.08f, 0.48f);
+ * axes.attachControlCallback([](){controlFlag.set(0x1); });
+ * axes.start({0.5f, 0.2f});
+ * while (1) { controlFlag.wait_any(0x1); axes.run(); }
+ * @tparam N maximum number of axes
+ */
+template<std::size_t N>
+class MotorCoordinator {
+    static_assert(N > 0, "Coordinator needs at least one axis");
+public:
+    struct Axis {
+        /** @param encoderArgs arguments of EncodedMotor constructor
+         * @param motorArgs arguments of MotorControl constructor after direction pins, encoder is this axis' encoder
+         */
+        template<typename... EncoderArgs, typename... MotorArgs>
+        Axis(std::tuple<EncoderArgs...>&& encoderArgs, PinName motorEnable, PinName motorDirection1,
+             PinName motorDirection2, MotorArgs... motorArgs)
+                : encoder(std::make_from_tuple<EncodedMotor>(std::move(encoderArgs))),
+                  encoderHandle(std::shared_ptr<EncodedMotor>(), &encoder),
+                  motor(motorEnable, motorDirection1, motorDirection2, encoderHandle, motorArgs...) {}
+
+        EncodedMotor encoder;
+        std::shared_ptr<EncodedMotor> encoderHandle;    // non-owning, MotorControl takes encoder as shared_ptr
+        MotorControl motor;
+        float refVolt = 0.0f;           // reference applied at start(), 0.0 - 1.0 of rated RPM
+        bool steady = false;            // steady state of last pass
+    };
+
+    /** @param controlRate rate of shared control tick in Hz (max 1000), 0 to tick only by tick()
+     * lowered to the sampling rate of the slowest PulseCount encoder as axes are added (see getControlRate())
+     */
+    explicit MotorCoordinator(float controlRate);
+    ~MotorCoordinator();
+
+    MotorCoordinator(const MotorCoordinator&) = delete;
+    MotorCoordinator& operator=(const MotorCoordinator&) = delete;
+
+    /** Construct encoder and controller of next axis in place, controller is switched to the shared tick
+     * @param encoderArgs arguments of EncodedMotor constructor as tuple
+     * @param motorEnable, motorDirection1, motorDirection2, motorArgs arguments of MotorControl constructor
+     * without encoder
+     * @return axis index, -1 if all N axes are in use
+     */
+    template<typename... EncoderArgs, typename... MotorArgs>
+    int addAxis(std::tuple<EncoderArgs...> encoderArgs, PinName motorEnable, PinName motorDirection1,
+                PinName motorDirection2, MotorArgs... motorArgs);
+
+    /** Start all axes at the same control tick
+     * @param refVolts reference of every axis, 0.0 - 1.0 of rated RPM
+     */
+    void start(const std::array<float, N>& refVolts);
+
+    /** Stop all axes at the same control tick, axes slow down along their speed profile */
+    void stop();
+
+    /** Step every axis once, call at every control tick
+     * @return true if all running axes are steady
+     */
+    bool run();
+
+    /** Advance control tick of all axes from external timebase, ISR safe */
+    void tick() { controlTick(); }
+
+    /** Attach function called from ISR after all axes are ticked
+     * @param func callback, e.g. set EventFlags to wake the control loop
+     */
+    void attachControlCallback(Callback<void()> func);
+
+    /** Rate of shared control tick in Hz, 0 if ticked only by tick() */
+    float getControlRate() const { return _controlRate; }
+
+    std::size_t size() const { return _size; }
+    bool isRunning() const { return _running; }
+    MotorControl& motor(std::size_t axis) { return this->axis(axis).motor; }
+    EncodedMotor& encoder(std::size_t axis) { return this->axis(axis).encoder; }
+
+    /** CPU cycles taken by the latest run() pass over all axes */
+    uint32_t getPassCycles() const { return _passCycles; }
+
+private:
+    void controlTick();
+    void attachTicker();
+    Axis& axis(std::size_t i) { return *std::launder(reinterpret_cast<Axis*>(&_axes[i])); }
+
+    std::array<std::aligned_storage_t<sizeof(Axis), alignof(Axis)>, N> _axes;   // first _size are constructed
+    std::size_t _size = 0;
+    bool _running = false;
+    float _controlRate = 0.0f;
+    Ticker _controlTicker;
+    Callback<void()> _controlCallback;
+    uint32_t _passCycles = 0;
+};
+
+
+template<std::size_t N>
+MotorCoordinator<N>::MotorCoordinator(float controlRate)
+{
+    // enable DWT cycle counter for run() cost measurement
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    _controlRate = controlRate > 1000 ? 1000 : controlRate;
+    attachTicker();
+}
+
+template<std::size_t N>
+MotorCoordinator<N>::~MotorCoordinator()
+{
+    _controlTicker.detach();
+    while (_size > 0) axis(--_size).~Axis();
+}
+
+template<std::size_t N>
+template<typename... EncoderArgs, typename... MotorArgs>
+int MotorCoordinator<N>::addAxis(std::tuple<EncoderArgs...> encoderArgs, PinName motorEnable,
+                                 PinName motorDirection1, PinName motorDirection2, MotorArgs... motorArgs)
+{
+    if (_size == N) return -1;
+    Axis* added = new (&_axes[_size]) Axis(std::move(encoderArgs), motorEnable, motorDirection1, motorDirection2,
+                                          motorArgs...);
+    added->motor.useExternalTick();
+    // PulseCount speed changes once per sampling period, a faster tick would step on a repeated speed
+    const EncodedMotor& encoder = added->encoder;
+    if (encoder.getEstimator() == SpeedEstimator::PulseCount && _controlRate > encoder.getSamplingRate()) {
+        _controlRate = encoder.getSamplingRate();
+        attachTicker();
+    }
+    return (int)_size++;
+}
+
+template<std::size_t N>
+void MotorCoordinator<N>::start(const std::array<float, N>& refVolts)
+{
+    // run() and start() share the control thread, so all references take effect at the next tick
+    for (std::size_t i = 0; i < _size; i++) {
+        axis(i).refVolt = refVolts[i];
+        axis(i).motor.clearFault();
+        axis(i).motor.setRefVolt(refVolts[i]);
+    }
+    _running = true;
+}
+
+template<std::size_t N>
+void MotorCoordinator<N>::stop()
+{
+    // every axis is stopped in the next run() pass
+    _running = false;
+}
+
+template<std::size_t N>
+bool MotorCoordinator<N>::run()
+{
+    uint32_t startCycle = DWT->CYCCNT;
+    bool steady = true;
+    bool fault = false;
+    for (std::size_t i = 0; i < _size; i++) {
+        Axis& axis = this->axis(i);
+        if (_running) axis.steady = axis.motor.run();
+        else {
+            axis.motor.stop();
+            axis.steady = false;
+        }
+        steady = steady && axis.steady;
+        fault = fault || axis.motor.getFault() != MotorControl::Fault::None;
+    }
+    // any axis fault stops all axes at the same tick so that they stay in step
+    if (fault && _running) {
+        stop();
+        for (std::size_t i = 0; i < _size; i++) {
+            axis(i).motor.stop();
+            axis(i).steady = false;
+        }
+    }
+    _passCycles = DWT->CYCCNT - startCycle;
+    return _running && steady;
+}
+
+template<std::size_t N>
+void MotorCoordinator<N>::attachControlCallback(Callback<void()> func)
+{
+    // controlTick() may call the callback from ISR, never let it see a half written one
+    core_util_critical_section_enter();
+    _controlCallback = func;
+    core_util_critical_section_exit();
+}
+
+template<std::size_t N>
+void MotorCoordinator<N>::attachTicker()
+{
+    _controlTicker.detach();
+    if (_controlRate > 0) _controlTicker.attach(callback(this, &MotorCoordinator::controlTick), 1/_controlRate);
+}
+
+template<std::size_t N>
+void MotorCoordinator<N>::controlTick()
+{
+    for (std::size_t i = 0; i < _size; i++) axis(i).motor.tick();
+    if (_controlCallback) _controlCallback.call();
+}
+
+#endif //MOTORCOORDINATOR_H
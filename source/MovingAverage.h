@@ -4,64 +4,92 @@
 
 #ifndef MOVINGAVERAGE_H
 #define MOVINGAVERAGE_H
-#include <deque>
+#include <array>
+#include <cstdint>
+#include <type_traits>
 
 /**
  * Moving average class
  * Example declaration: MovingAverage<float, 7> average1(3.14);
+ * Data is kept in a fixed ring buffer (no heap), sum is updated incrementally so AddData() is O(1)
+ * Integral T is summed in a 64-bit integer accumulator (exact),
+ * floating point T re-sums the buffer once per N data (amortised O(1)) so rounding error of the
+ * running sum cannot drift over long runs
  * @tparam T data storage type
  * @tparam N number of elements to average, cannot be odd or less than 1
  */
 template<typename T, int N>
 class MovingAverage {
+    static_assert(N>0, "Number of elements has to be greater than 0");
+    static_assert(N%2==1, "Number of elements has to be odd (for stability)");
 public:
-    MovingAverage(){
-        static_assert(N>0, "Number of elements has to be greater than 0");
-        static_assert(N%2==1, "Number of elements has to be odd (for stability)");
-    }
+    MovingAverage() = default;
     explicit MovingAverage(T initialData);
     void AddData(T data);
-    const std::deque<T>& getDataList() const
+
+    /** Data in chronological order (oldest first), only first size() elements are valid */
+    std::array<T, N> getDataList() const;
+    int size() const
     {
-        return _dataList;
+        return _count;
     }
     T getValue() const
     {
         return _value;
     }
 private:
-    std::deque<T> _dataList;
-    T _value;
-    const double N_recipro = 1.0/N;
+    using accumulator_t = typename std::conditional<std::is_integral<T>::value, int64_t, T>::type;
+
+    void resum();
+
+    std::array<T, N> _dataList{};
+    int _head = 0;                      // index of oldest element once buffer is full
+    int _count = 0;
+    accumulator_t _sum = 0;
+    T _value = 0;
 };
 
 
 template<typename T, int N>
-MovingAverage<T, N>::MovingAverage(T initialData) :  _value(initialData)
+MovingAverage<T, N>::MovingAverage(T initialData)
 {
-    MovingAverage();
-    _dataList.push_back(initialData);
+    AddData(initialData);
 }
 
 template<typename T, int N>
 void MovingAverage<T, N>::AddData(T data)
 {
-    T sum = 0;
-    if(_dataList.size()<N){
-        _dataList.push_back(data);
-        for(auto &val: _dataList){
-            sum += val;
-        }
-        _value = sum/_dataList.size();
+    if(_count<N){
+        _dataList[_count++] = data;
+        _sum += data;
     }
     else{
-        _dataList.pop_front();
-        _dataList.push_back(data);
-        for(auto &val: _dataList){
-            sum += val;
-        }
-        _value = sum*N_recipro;
+        _sum += (accumulator_t)data - (accumulator_t)_dataList[_head];
+        _dataList[_head] = data;
+        _head = (_head + 1 == N) ? 0 : _head + 1;
+        if (!std::is_integral<T>::value && _head == 0) resum();    // discard accumulated rounding error
+    }
+    _value = (T)(_sum / _count);
+}
+
+template<typename T, int N>
+void MovingAverage<T, N>::resum()
+{
+    accumulator_t sum = 0;
+    for (auto &val: _dataList) {
+        sum += val;
+    }
+    _sum = sum;
+}
+
+template<typename T, int N>
+std::array<T, N> MovingAverage<T, N>::getDataList() const
+{
+    std::array<T, N> dataList{};
+    for (int i = 0; i < _count; i++) {
+        dataList[i] = _dataList[(_head + i) % N];
     }
+    return dataList;
 }
 
 #endif //MOVINGAVERAGE_H
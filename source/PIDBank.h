@@ -0,0 +1,144 @@
+#pragma once
+
+#ifndef PIDBANK_H
+#define PIDBANK_H
+
+#include <array>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+/** Bank of N positional PID loops stepped together
+ * Gains, states and limits are kept as parallel arrays (structure of arrays) and step() runs all loops
+ * in one branch-free loop, so GCC vectorises it on hosts with SIMD and it stays free of branch
+ * misprediction on Cortex-M4 (single precision FPU, DSP SIMD instructions are integer only)
+ * Same control law as PIDcontrol in Positional form with BackCalculation anti-windup:
+ * derivative on measurement with first order low-pass, Kd and Ki per second
+ *
+ * Example:
+ * PIDBank<2> bank;
+ * bank.setGains(0, 0.2f, 2.0f, 0.08f);
+ * bank.setOutputLimits(0, 0.0f, 100.0f);
+ * const auto& output = bank.step(errors, measurements, timeStep_us);
+ * @tparam N number of loops
+ */
+template<std::size_t N>
+class PIDBank {
+    static_assert(N > 0, "Bank needs at least one loop");
+public:
+    using Signals = std::array<float, N>;
+
+    PIDBank();
+
+    /** Set gains of one loop
+     * @param derivativeCutoff derivative low-pass cutoff in Hz, 0 to disable filter
+     * @param trackingGain back calculation gain (1/s), 0 to use Ki / Kp
+     */
+    void setGains(std::size_t loop, float Kp, float Ki, float Kd, float derivativeCutoff = 0.2f,
+                  float trackingGain = 0);
+
+    /** Set range of output of one loop, default is unlimited */
+    void setOutputLimits(std::size_t loop, float minOutput, float maxOutput);
+
+    /** Restart one loop from given output without bump
+     * integrator of first step is initialised so that P + I + D equals output,
+     * derivative filter holds at 0 until the step after, as in PIDcontrol
+     */
+    void reset(std::size_t loop, float output = 0.0f, float measurement = 0.0f);
+
+    /** Step all loops
+     * @param error setpoint - measurement of every loop
+     * @param measurement process variable of every loop, used by derivative term
+     * @param timeStep_us time since previous step in microseconds, shared by all loops
+     * @return output of every loop within output limits
+     */
+    const Signals& step(const Signals& error, const Signals& measurement, uint32_t timeStep_us);
+
+    const Signals& getOutput() const { return _output; }
+
+private:
+    alignas(16) Signals _Kp{};
+    alignas(16) Signals _Ki{};
+    alignas(16) Signals _Kd{};
+    alignas(16) Signals _derivativeTau{};       // derivative filter time constant (s)
+    alignas(16) Signals _trackingGain{};
+    alignas(16) Signals _minOutput;
+    alignas(16) Signals _maxOutput;
+
+    alignas(16) Signals _integral{};            // integral term in output unit
+    alignas(16) Signals _filteredDerivative{};  // measurement per second
+    alignas(16) Signals _prevMeasurement{};
+    alignas(16) Signals _output{};
+    alignas(16) Signals _restart;               // 1 until first step after reset, 0 after
+};
+
+
+template<std::size_t N>
+PIDBank<N>::PIDBank()
+{
+    _minOutput.fill(-1e30f);
+    _maxOutput.fill(1e30f);
+    _restart.fill(1.0f);
+}
+
+template<std::size_t N>
+void PIDBank<N>::setGains(std::size_t loop, float Kp, float Ki, float Kd, float derivativeCutoff, float trackingGain)
+{
+    if (loop >= N) return;
+    _Kp[loop] = Kp;
+    _Ki[loop] = Ki;
+    _Kd[loop] = Kd;
+    _derivativeTau[loop] = derivativeCutoff > 0 ? 1 / (2 * 3.14159265f * derivativeCutoff) : 0.0f;
+    _trackingGain[loop] = trackingGain > 0 ? trackingGain : (Kp > 0 ? Ki / Kp : 1.0f);
+}
+
+template<std::size_t N>
+void PIDBank<N>::setOutputLimits(std::size_t loop, float minOutput, float maxOutput)
+{
+    if (loop >= N) return;
+    _minOutput[loop] = minOutput;
+    _maxOutput[loop] = maxOutput;
+}
+
+template<std::size_t N>
+void PIDBank<N>::reset(std::size_t loop, float output, float measurement)
+{
+    if (loop >= N) return;
+    _integral[loop] = output;
+    _filteredDerivative[loop] = 0.0f;
+    _prevMeasurement[loop] = measurement;
+    _output[loop] = output;
+    _restart[loop] = 1.0f;
+}
+
+template<std::size_t N>
+const typename PIDBank<N>::Signals& PIDBank<N>::step(const Signals& error, const Signals& measurement,
+                                                     uint32_t timeStep_us)
+{
+    if (timeStep_us == 0) return _output;
+    const float dt = timeStep_us * 1e-6f;
+    const float rate = 1 / dt;
+
+    // no branch in loop body, limits by min / max
+    for (std::size_t i = 0; i < N; i++) {
+        // no previous measurement on first step, derivative filter holds (as PIDcontrol) by mask instead of branch
+        float signal = (measurement[i] - _prevMeasurement[i]) * rate;
+        float derivative = _filteredDerivative[i]
+                           + (1 - _restart[i]) * (signal - _filteredDerivative[i]) * dt / (_derivativeTau[i] + dt);
+        float proportional = _Kp[i] * error[i];
+        float derivativeTerm = -_Kd[i] * derivative;
+        // bumpless first step by mask instead of branch
+        float integral = _integral[i] - _restart[i] * (proportional + derivativeTerm) + _Ki[i] * error[i] * dt;
+        float unlimited = proportional + integral + derivativeTerm;
+        float output = std::min(std::max(unlimited, _minOutput[i]), _maxOutput[i]);
+
+        _integral[i] = integral + _trackingGain[i] * (output - unlimited) * dt;
+        _filteredDerivative[i] = derivative;
+        _prevMeasurement[i] = measurement[i];
+        _output[i] = output;
+        _restart[i] = 0.0f;
+    }
+    return _output;
+}
+
+#endif //PIDBANK_H
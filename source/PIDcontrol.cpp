@@ -1,30 +1,81 @@
-#include "mbed.h"
 #include "PIDcontrol.h"
-#include "MovingAverage.h"
+#include <cmath>
 
-MovingAverage<float,21> smoothing_D;
-
-PIDcontrol::PIDcontrol(float Kp, float Ki, float Kd)
+PIDcontrol::PIDcontrol(float Kp, float Ki, float Kd, float derivativeCutoff)
 	: _Kp(Kp), _Ki(Ki), _Kd(Kd)
 {
+	setDerivativeCutoff(derivativeCutoff);
+}
+
+void PIDcontrol::setDerivativeCutoff(float derivativeCutoff)
+{
+	_derivativeTau = (derivativeCutoff > 0) ? 1 / (2 * (float)M_PI * derivativeCutoff) : 0.0f;
 }
 
 float PIDcontrol::compensateSignal(float error, unsigned long long int timeStep)
 {
-	_compensateError = 0.0f; 
+	// d(error)/dt = -d(measurement)/dt for constant setpoint
+	return compensateSignal(error, -error, timeStep);
+}
 
+float PIDcontrol::compensateSignal(float error, float measurement, unsigned long long int timeStep)
+{
 	_thisError = error;
-	_timeStep = timeStep;
+	_thisMeasurement = measurement;
+	_timeStep = (uint32_t)timeStep;
+	float dt = _timeStep * 1e-6f;      // _timeStep in microseconds
 
-	_compensateError += P_signal(); 
-	_compensateError += I_signal();
-	_compensateError += D_signal();
+	bool firstStep = !_hasPrevMeasurement;
+	float P = P_signal();
+	float D = D_signal();
+	float unlimited;
+	if (_form == Form::Velocity) {
+		// change of each term, the limited output carries the integral action
+		if (firstStep) { _prevP = P; _prevD = D; }
+		unlimited = _compensateError + (P - _prevP) + _Ki * _thisError * dt + (D - _prevD);
+		_prevP = P;
+		_prevD = D;
+	}
+	else {
+		if (firstStep) _integral = _compensateError - P - D;     // bumpless start from current output
+		float integral = _integral;
+		float I = I_signal();
+		unlimited = P + I + D;
+		if (_antiWindup == AntiWindup::Conditional) {
+			bool saturatedHigh = unlimited > _maxOutput && _thisError > 0;
+			bool saturatedLow = unlimited < _minOutput && _thisError < 0;
+			if (saturatedHigh || saturatedLow) {
+				_integral = integral;               // discard this step of integration
+				unlimited = P + _integral + D;
+			}
+		}
+	}
+
+	_compensateError = limitOutput(unlimited, dt);
+	if (_form == Form::Positional && _antiWindup == AntiWindup::BackCalculation) {
+		float trackingGain = _trackingGain > 0 ? _trackingGain : (_Kp > 0 ? _Ki / _Kp : 1.0f);
+		_integral += trackingGain * (_compensateError - unlimited) * dt;
+	}
 
     _prevError = _thisError;    // update Previous Error for next calculation
+    _prevMeasurement = _thisMeasurement;
+    _hasPrevMeasurement = true;
 
     return _compensateError;
 }
 
+float PIDcontrol::limitOutput(float output, float dt) const
+{
+	if (_slewRate > 0) {
+		float maxStep = _slewRate * dt;
+		if (output > _compensateError + maxStep) output = _compensateError + maxStep;
+		else if (output < _compensateError - maxStep) output = _compensateError - maxStep;
+	}
+	if (output > _maxOutput) output = _maxOutput;
+	else if (output < _minOutput) output = _minOutput;
+	return output;
+}
+
 float PIDcontrol::P_signal()
 {
 	return _Kp * _thisError; 
@@ -32,12 +83,83 @@ float PIDcontrol::P_signal()
 
 float PIDcontrol::I_signal()
 {
-	_accError_t += _thisError * _timeStep /1000000;  // _timeStep in microseconds
-	return _Ki * (_accError_t);
+	_integral += _Ki * _thisError * (_timeStep * 1e-6f);  // _timeStep in microseconds
+	return _integral;
 }
 
 float PIDcontrol::D_signal() {
-    float signal = (_thisError - _prevError)/_timeStep;
-	smoothing_D.AddData(signal);
-    return smoothing_D.getValue();
+    if (_timeStep == 0 || !_hasPrevMeasurement) return -_Kd * _filteredDerivative;
+    float dt = _timeStep * 1e-6f;
+    float signal = (_thisMeasurement - _prevMeasurement)/dt;     // measurement per second
+
+    // first order low-pass (backward Euler), handles irregular timeStep
+    _filteredDerivative += (signal - _filteredDerivative) * dt / (_derivativeTau + dt);
+    return -_Kd * _filteredDerivative;
+}
+
+void PIDcontrol::setForm(PIDcontrol::Form form)
+{
+	_form = form;
+	reset(_compensateError);
+}
+
+void PIDcontrol::setAntiWindup(PIDcontrol::AntiWindup antiWindup, float trackingGain)
+{
+	_antiWindup = antiWindup;
+	_trackingGain = trackingGain;
+}
+
+void PIDcontrol::setOutputLimits(float minOutput, float maxOutput)
+{
+	_minOutput = minOutput;
+	_maxOutput = maxOutput;
+}
+
+void PIDcontrol::setSlewLimit(float slewRate)
+{
+	_slewRate = slewRate;
+}
+
+void PIDcontrol::reset(float output)
+{
+	// next step continues from output, integrator is re-initialised there
+	_compensateError = output;
+	_filteredDerivative = 0.0f;
+	_hasPrevMeasurement = false;
+}
+
+float PIDcontrol::getOutput() const
+{
+	return _compensateError;
+}
+
+void PIDcontrol::setGains(float Kp, float Ki, float Kd)
+{
+	// bumpless transfer, keep output of last step unchanged under new gains
+	if (_form == Form::Positional) _integral += (_Kp - Kp) * _thisError - (_Kd - Kd) * _filteredDerivative;
+	else {
+		_prevP = Kp * _thisError;
+		_prevD = -Kd * _filteredDerivative;
+	}
+	_Kp = Kp;
+	_Ki = Ki;
+	_Kd = Kd;
+}
+
+float PIDcontrol::getKp() const { return _Kp; }
+
+float PIDcontrol::getKi() const { return _Ki; }
+
+float PIDcontrol::getKd() const { return _Kd; }
+
+void PIDcontrol::setGainSchedule(const GainSchedule& schedule)
+{
+	_schedule = schedule;
+}
+
+void PIDcontrol::scheduleGains(float reference)
+{
+	if (_schedule.empty()) return;
+	GainPoint gains = _schedule.lookup(reference);
+	if (gains.Kp != _Kp || gains.Ki != _Ki || gains.Kd != _Kd) setGains(gains.Kp, gains.Ki, gains.Kd);
 }
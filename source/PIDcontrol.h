@@ -3,31 +3,118 @@
 #ifndef PICONTROL_H
 #define PICONTROL_H
 
+#include <cstdint>
+#include "GainSchedule.h"
+
 class EncodedMotor; 
 
+/** PID controller
+ * Derivative is taken on measurement (no derivative kick on setpoint change)
+ * and low-pass filtered per instance by first order filter, O(1) per step
+ * Every instance keeps its own state, multiple controllers can run side by side
+ * Output is limited by the controller (range and slew rate), integrator is protected against windup
+ */
 class PIDcontrol {
 public:
+	/** Positional: output = P + I + D, integrator state protected by AntiWindup
+	 * Velocity: output += change of P + I + D, limited output is the only state (windup free)
+	 */
+	enum class Form : uint8_t {Positional, Velocity};
+
+	/** Anti-windup of Positional form
+	 * Conditional: stop integrating while output is saturated and error drives further into saturation
+	 * BackCalculation: bleed integrator by trackingGain * (limited output - unlimited output)
+	 */
+	enum class AntiWindup : uint8_t {None, Conditional, BackCalculation};
+
 	PIDcontrol() = delete;
-	PIDcontrol(float Kp, float Ki, float Kd);
+	PIDcontrol(float Kp, float Ki, float Kd, float derivativeCutoff = 0.2f);
+
+	/** Compute controller output
+	 * @param error setpoint - measurement
+	 * @param measurement process variable, used by derivative term
+	 * @param timeStep time since previous step in microseconds
+	 * @return controller output within output limits
+	 */
+	float compensateSignal(float error, float measurement, unsigned long long int timeStep);
+
+	/** Compute controller output with derivative taken on error (constant setpoint assumed) */
 	float compensateSignal(float error, unsigned long long int timeStep);
 
+	/** Set derivative low-pass cutoff
+	 * @param derivativeCutoff cutoff frequency in Hz, 0 to disable filter
+	 */
+	void setDerivativeCutoff(float derivativeCutoff);
+
+	void setForm(Form form);
+
+	/** Set anti-windup of Positional form
+	 * @param antiWindup method, default is BackCalculation
+	 * @param trackingGain back calculation gain (1/s), 0 to use Ki / Kp
+	 */
+	void setAntiWindup(AntiWindup antiWindup, float trackingGain = 0);
+
+	/** Set range of output, default is unlimited */
+	void setOutputLimits(float minOutput, float maxOutput);
+
+	/** Set maximum change of output per second, 0 to disable (default) */
+	void setSlewLimit(float slewRate);
+
+	/** Restart controller from given output without bump, clears integrator and derivative history */
+	void reset(float output = 0.0f);
+
+	float getOutput() const;
+
+	/** Change gains without bump in output
+	 * integral term is kept in output unit, and takes up the jump of P and D terms
+	 */
+	void setGains(float Kp, float Ki, float Kd);
+
+	/** Schedule gains by reference, empty schedule to use fixed gains (default)
+	 * points of schedule are not copied and must outlive the controller
+	 */
+	void setGainSchedule(const GainSchedule& schedule);
+
+	/** Apply gains interpolated at reference from gain schedule, call before compensateSignal() */
+	void scheduleGains(float reference);
+	float getKp() const;
+	float getKi() const;
+	float getKd() const;
+
 protected: 
 	float P_signal();
 	float I_signal();
 	float D_signal();
 
 private:
+	float limitOutput(float output, float dt) const;
+
 	float _Kp = 0.0f; 
 	float _Ki = 0.0f;
 	float _Kd = 0.0f;
 
 	float _thisError = 0.0f;
 	float _prevError = 0.0f;
-	float _accError_t = 0.0f; 
-	unsigned long long _timeStep = 0;
+	float _integral = 0.0f;         // integral term in output unit
+	uint32_t _timeStep = 0;         // microseconds
 	float _compensateError = 0.0f; 
 
+	float _thisMeasurement = 0.0f;
+	float _prevMeasurement = 0.0f;
+	bool _hasPrevMeasurement = false;
+	float _derivativeTau = 0.0f;    // derivative filter time constant (s), 0 when disabled
+	float _filteredDerivative = 0.0f;
+
+	Form _form = Form::Positional;
+	AntiWindup _antiWindup = AntiWindup::BackCalculation;
+	float _trackingGain = 0.0f;
+	float _minOutput = -1e30f;
+	float _maxOutput = 1e30f;
+	float _slewRate = 0.0f;
+	float _prevP = 0.0f;            // Velocity form, P and D of previous step
+	float _prevD = 0.0f;
+	GainSchedule _schedule;
+
 };
 
 #endif // !PICONTROL_H
-
@@ -0,0 +1,83 @@
+#pragma once
+
+#ifndef PULSECOUNTER_H
+#define PULSECOUNTER_H
+
+#include <cstdint>
+
+enum class EncodeType:uint8_t {
+  X1 = 1,
+  X2 = 2,
+  X4 = 4
+};
+
+/** Source of encoder pulses for EncodedMotor
+ * Implementations count encoder edges by whatever means the hardware provides,
+ * EncodedMotor only collects the count once per sampling period through takePulses()
+ * Count is signed, positive when encoder channel B leads channel A
+ * Keep this header free of mbed so a counter can be substituted on host
+ */
+class PulseCounter {
+public:
+    /** Timing of latest counted edge, times in us */
+    struct EdgeTime {
+        unsigned long long lastEdge = 0;    // time of latest edge
+        unsigned long edgePeriod = 0;       // time between latest two edges
+        int8_t direction = 0;               // +1 / -1 of latest edge, 0 if no edge counted yet
+    };
+
+    /** Function called from counting ISR when compare is reached */
+    using CompareHandler = void (*)(void* context);
+
+    virtual ~PulseCounter() = default;
+
+    /** Start counting, pulse count starts from 0 */
+    virtual void start() = 0;
+
+    /** Stop counting, pulses after stop() are not counted */
+    virtual void stop() = 0;
+
+    /** Collect pulses counted since previous call and restart the count
+     * Called from the EncodedMotor sampling ISR
+     * @return signed number of pulses since previous call
+     */
+    virtual long takePulses() = 0;
+
+    /** Pulses counted since previous takePulses() without restarting the count
+     * Safe from thread, counters that cannot read the count in progress return 0
+     */
+    virtual long peekPulses() const { return 0; }
+
+    /** Call handler from counting ISR at the edge where count since previous takePulses() reaches compare
+     * Compare is disarmed before handler is called, handler may arm the next one
+     * Compare is relative to the count, so it has to be armed again after every takePulses()
+     * @param compare pulses since previous takePulses()
+     * @param direction +1 if count has to rise to compare, -1 if it has to fall
+     * @return false if counter cannot compare at every edge, compare is then up to EncodedMotor
+     */
+    virtual bool armCompare(long compare, int8_t direction, CompareHandler handler, void* context) { return false; }
+    virtual void disarmCompare() {}
+
+    /** Number of invalid quadrature transitions (both channels changed at once) since start()
+     * Counters that cannot detect invalid transitions return 0
+     */
+    virtual unsigned long getInvalidTransitions() const { return 0; }
+
+    /** Check if counter timestamps every counted edge
+     * Counters that cannot timestamp edges only support pulse counting speed estimation
+     */
+    virtual bool hasEdgeTime() const { return false; }
+
+    /** Get timing of latest edge, valid only if hasEdgeTime()
+     * Called from the EncodedMotor sampling ISR, or from thread with getEdgeSequence() retry
+     */
+    virtual EdgeTime getEdgeTime() const { return EdgeTime(); }
+
+    /** Sequence of counted edges, odd while the counting ISR updates count and edge time
+     * Reader outside the counting ISR retries peekPulses() and getEdgeTime() if it changed meanwhile
+     * Counters without edge ISR return 0
+     */
+    virtual uint32_t getEdgeSequence() const { return 0; }
+};
+
+#endif //PULSECOUNTER_H
@@ -0,0 +1,113 @@
+#include "QuadratureDecoder.h"
+
+namespace {
+    const int8_t INVALID = 2;
+    // indexed by (previous AB << 2) | current AB, forward sequence 00 -> 01 -> 11 -> 10 -> 00
+    const int8_t quadratureTable[16] = {
+             0,  1, -1, INVALID,     // from 00
+            -1,  0, INVALID,  1,     // from 01
+             1, INVALID,  0, -1,     // from 10
+            INVALID, -1,  1,  0      // from 11
+    };
+}
+
+void QuadratureDecoder::start(uint8_t state)
+{
+    _pulseBuffer = 0;
+    _invalidTransitions = 0;
+    _previousState = state & 0x3;
+    _edgeTime = PulseCounter::EdgeTime();
+}
+
+int8_t QuadratureDecoder::decodeTransition(uint8_t state, unsigned long long time_us)
+{
+    state &= 0x3;
+    int8_t step = quadratureTable[(_previousState << 2) | state];
+    _previousState = state;
+    if (step == INVALID) {
+        _invalidTransitions = _invalidTransitions + 1;      // missed edge or bounce, direction unknown
+        return 0;
+    }
+    if (step != 0) count(step, time_us);
+    return step;
+}
+
+int8_t QuadratureDecoder::decodeEdgeA(uint8_t state, unsigned long long time_us)
+{
+    // A rises with B high, falls with B low when B leads
+    int8_t step = ((state >> 1) & 1) == (state & 1) ? 1 : -1;
+    count(step, time_us);
+    return step;
+}
+
+long QuadratureDecoder::takePulses()
+{
+    // called from Ticker ISR, encoder interrupts have the same priority hence cannot preempt this
+    long pulses = _pulseBuffer;
+    _pulseBuffer = 0;
+    return pulses;
+}
+
+void QuadratureDecoder::armCompare(long compare, int8_t direction, PulseCounter::CompareHandler handler, void* context)
+{
+    // called from Ticker ISR or with interrupts disabled, encoder interrupts cannot preempt this
+    _compare = compare;
+    _compareHandler = handler;
+    _compareContext = context;
+    _compareDirection = handler != nullptr ? direction : 0;
+}
+
+void QuadratureDecoder::count(int8_t step, unsigned long long time_us)
+{
+    // readers run on the same core, compiler ordering around the sequence is enough
+    _edgeSequence = _edgeSequence + 1;
+    std::atomic_signal_fence(std::memory_order_release);
+    _pulseBuffer = _pulseBuffer + step;
+    if (_timestampEdges) {
+        // period across a direction change is not a rotation period
+        _edgeTime.edgePeriod = (_edgeTime.direction == step) ? (unsigned long)(time_us - _edgeTime.lastEdge) : 0;
+        _edgeTime.lastEdge = time_us;
+        _edgeTime.direction = step;
+    }
+    std::atomic_signal_fence(std::memory_order_release);
+    _edgeSequence = _edgeSequence + 1;
+
+    // one comparison per edge, whatever number of positions are watched by EncodedMotor
+    if (_compareDirection != 0 && (_pulseBuffer - _compare) * _compareDirection >= 0) {
+        _compareDirection = 0;
+        _compareHandler(_compareContext);
+    }
+}
+
+
+void CounterUnwrapper::start(uint16_t count)
+{
+    _previousCount = count;
+    _residual = 0;
+}
+
+long CounterUnwrapper::pulses(uint16_t count) const
+{
+    auto diff = (int16_t)(uint16_t)(count - _previousCount);   // wrap around handled by 16-bit arithmetic
+    return _inverted ? -diff : diff;
+}
+
+long CounterUnwrapper::takePulses(uint16_t count)
+{
+    long pulses = this->pulses(count);
+    _previousCount = count;
+    if (_encodeType == EncodeType::X1) {
+        // X1 hardware counts both edges of channel A, halve for rising edge only
+        pulses += _residual;
+        _residual = pulses % 2;
+        pulses /= 2;
+    }
+    return pulses;
+}
+
+long CounterUnwrapper::peekPulses(uint16_t count) const
+{
+    long pulses = this->pulses(count);
+    if (_encodeType == EncodeType::X1) pulses = (pulses + _residual) / 2;
+    return pulses;
+}
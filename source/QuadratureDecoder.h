@@ -0,0 +1,90 @@
+#pragma once
+
+#ifndef QUADRATUREDECODER_H
+#define QUADRATUREDECODER_H
+
+#include <atomic>
+#include <cstdint>
+#include "PulseCounter.h"
+
+/** Decode and count quadrature edges in software, free of mbed so it runs on host
+ * Used by InterruptPulseCounter (one call per edge ISR) and by host fakes
+ * State is (A << 1) | B read right after the edge
+ * X4 decodes every edge through a (previous AB, current AB) transition table,
+ * X1 and X2 take direction from level of channel B at edge of channel A
+ * Count is signed, positive when encoder channel B leads channel A
+ */
+class QuadratureDecoder {
+public:
+    explicit QuadratureDecoder(bool timestampEdges = false) : _timestampEdges(timestampEdges) {}
+
+    /** Restart count from 0 at given AB state */
+    void start(uint8_t state);
+
+    /** X4 edge of A or B, count transition from previous state
+     * @param time_us time of edge, only used if edges are timestamped
+     * @return counted step (+1 / -1), 0 if state is unchanged or transition is invalid
+     */
+    int8_t decodeTransition(uint8_t state, unsigned long long time_us = 0);
+
+    /** X1 / X2 edge of A, forward when A equals B right after edge of A
+     * @return counted step (+1 / -1)
+     */
+    int8_t decodeEdgeA(uint8_t state, unsigned long long time_us = 0);
+
+    /** Collect and restart count, see PulseCounter::takePulses() */
+    long takePulses();
+    long peekPulses() const { return _pulseBuffer; }   // single word read, atomic on Cortex-M
+
+    /** See PulseCounter::armCompare(), compare is checked at every counted edge */
+    void armCompare(long compare, int8_t direction, PulseCounter::CompareHandler handler, void* context);
+    void disarmCompare() { _compareDirection = 0; }
+
+    unsigned long getInvalidTransitions() const { return _invalidTransitions; }
+    bool hasEdgeTime() const { return _timestampEdges; }
+    PulseCounter::EdgeTime getEdgeTime() const { return _edgeTime; }
+    uint32_t getEdgeSequence() const { return _edgeSequence; }
+
+private:
+    void count(int8_t step, unsigned long long time_us);
+
+    bool _timestampEdges;
+    volatile long _pulseBuffer = 0;
+    volatile uint32_t _edgeSequence = 0;       // odd while count() runs, see PulseCounter::getEdgeSequence()
+    volatile unsigned long _invalidTransitions = 0;
+    uint8_t _previousState = 0;         // AB state at previous edge
+    PulseCounter::EdgeTime _edgeTime;
+    long _compare = 0;
+    volatile int8_t _compareDirection = 0;      // 0 when disarmed
+    PulseCounter::CompareHandler _compareHandler = nullptr;
+    void* _compareContext = nullptr;
+};
+
+/** Unwrap a free running 16-bit hardware encoder count, free of mbed so it runs on host
+ * Used by TimerPulseCounter with TIM1->CNT
+ * Count has to be taken before 32767 counts accumulate, difference is taken in 16-bit arithmetic
+ * X1 counts both edges of channel A in hardware, half of them are dropped and an odd count is carried
+ */
+class CounterUnwrapper {
+public:
+    CounterUnwrapper(EncodeType encodeType, bool inverted) : _encodeType(encodeType), _inverted(inverted) {}
+
+    /** Restart from given hardware count */
+    void start(uint16_t count);
+
+    /** Pulses since previous takePulses(), see PulseCounter::takePulses() */
+    long takePulses(uint16_t count);
+
+    /** Pulses since previous takePulses() without restarting */
+    long peekPulses(uint16_t count) const;
+
+private:
+    long pulses(uint16_t count) const;  // signed, X1 residual not applied
+
+    EncodeType _encodeType;
+    bool _inverted;                 // hardware counts up when A leads, invert to count B leading as positive
+    uint16_t _previousCount = 0;
+    long _residual = 0;             // X1 only, half pulse carried to next takePulses()
+};
+
+#endif //QUADRATUREDECODER_H
@@ -0,0 +1,126 @@
+#include "RelayAutoTuner.h"
+#include "PIDcontrol.h"
+
+void RelayAutoTuner::start(float setpoint, float bias, float amplitude, float hysteresis,
+                           unsigned int cycles, TuningRule rule)
+{
+    _setpoint = setpoint;
+    _bias = bias;
+    _amplitude = amplitude;
+    _hysteresis = hysteresis;
+    _cycles = cycles > 0 ? cycles : 1;
+    _rule = rule;
+
+    _relayHigh = true;
+    _hasSwitched = false;
+    _cycleCount = 0;
+    _sumAmplitude = 0.0f;
+    _sumPeriod = 0.0f;
+    _state = State::Running;
+}
+
+void RelayAutoTuner::startWithin(float setpoint, float amplitude, float minOutput, float maxOutput, float hysteresis,
+                                 unsigned int cycles, TuningRule rule)
+{
+    // keep relay within output range
+    float bias = setpoint;
+    if (bias < minOutput + amplitude) bias = minOutput + amplitude;
+    else if (bias > maxOutput - amplitude) bias = maxOutput - amplitude;
+    start(setpoint, bias, amplitude, hysteresis, cycles, rule);
+}
+
+float RelayAutoTuner::update(float measurement, uint32_t time_us, PIDcontrol& pid, float feedforward)
+{
+    float output = update(measurement, time_us);
+    if (isRunning()) return output;
+    if (isFinished()) {
+        pid.setGainSchedule(GainSchedule());
+        pid.setGains(_gains.Kp, _gains.Ki, _gains.Kd);
+    }
+    // resume PID from relay output (bias) without bump
+    pid.reset(output - feedforward);
+    return output;
+}
+
+float RelayAutoTuner::update(float measurement, uint32_t time_us)
+{
+    if (_state != State::Running) return _bias;
+    if (!_hasSwitched) {
+        // reference time taken at first update
+        _hasSwitched = true;
+        _lastSwitchTime = time_us;
+        _cycleStartTime = time_us;
+        _cycleMax = _cycleMin = measurement;
+        _cycleCount = 0;
+    }
+
+    if (measurement > _cycleMax) _cycleMax = measurement;
+    if (measurement < _cycleMin) _cycleMin = measurement;
+
+    if (_relayHigh && measurement > _setpoint + _hysteresis) {
+        _relayHigh = false;
+        _lastSwitchTime = time_us;
+    }
+    else if (!_relayHigh && measurement < _setpoint - _hysteresis) {
+        // low -> high switch marks start of next cycle
+        _relayHigh = true;
+        _lastSwitchTime = time_us;
+        completeCycle(time_us);
+    }
+    else if (time_us - _lastSwitchTime > _timeout_us) {
+        abort();                // relay too weak to cross setpoint, or measurement lost
+        return _bias;
+    }
+
+    if (_state != State::Running) return _bias;
+    return _relayHigh ? _bias + _amplitude : _bias - _amplitude;
+}
+
+void RelayAutoTuner::completeCycle(uint32_t time_us)
+{
+    if (_cycleCount > 0) {      // first cycle includes approach to setpoint
+        _sumAmplitude += (_cycleMax - _cycleMin) / 2;
+        _sumPeriod += (time_us - _cycleStartTime) * 1e-6f;
+    }
+    _cycleCount++;
+    _cycleStartTime = time_us;
+    _cycleMax = _cycleMin = _setpoint;
+
+    if (_cycleCount > _cycles) {
+        computeGains();
+        _state = (_ultimateGain > 0 && _ultimatePeriod > 0) ? State::Finished : State::Failed;
+    }
+}
+
+void RelayAutoTuner::computeGains()
+{
+    const float pi = 3.14159265f;
+    float oscillation = _sumAmplitude / _cycles;
+    _ultimatePeriod = _sumPeriod / _cycles;
+    _ultimateGain = oscillation > 0 ? 4 * _amplitude / (pi * oscillation) : 0.0f;
+
+    float Kp, Ti, Td;
+    if (_rule == TuningRule::TyreusLuyben) {
+        Kp = _ultimateGain / 2.2f;
+        Ti = 2.2f * _ultimatePeriod;
+        Td = _ultimatePeriod / 6.3f;
+    }
+    else {
+        Kp = 0.6f * _ultimateGain;
+        Ti = _ultimatePeriod / 2;
+        Td = _ultimatePeriod / 8;
+    }
+    _gains.Kp = Kp;
+    _gains.Ki = Ti > 0 ? Kp / Ti : 0.0f;
+    _gains.Kd = Kp * Td;
+}
+
+void RelayAutoTuner::abort()
+{
+    _state = State::Failed;
+}
+
+void RelayAutoTuner::setTimeout(uint32_t timeout_us)
+{
+    _timeout_us = timeout_us;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#ifndef RELAYAUTOTUNER_H
+#define RELAYAUTOTUNER_H
+
+#include <cstdint>
+
+class PIDcontrol;
+
+/** Relay feedback (Astrom-Hagglund) auto-tuner
+ * Output switches between bias + amplitude and bias - amplitude whenever measurement crosses setpoint
+ * (with hysteresis), the resulting limit cycle gives ultimate gain Ku = 4 * amplitude / (pi * a)
+ * and ultimate period Tu, from which PID gains are computed by the selected rule
+ * Free of mbed, update() is called at control rate with measurement and time
+ *
+ * Example:
+ * RelayAutoTuner tuner(50.0f, 40.0f, 20.0f);
+ * output = tuner.update(speed, time_us);  // until tuner.isFinished()
+ *
+ * Handing over to a PID controller (as MotorControl does):
+ * tuner.startWithin(50.0f, 20.0f, 0.0f, 100.0f);
+ * output = tuner.update(speed, time_us, pid);  // pid takes over with tuned gains once tuner stops
+ */
+class RelayAutoTuner {
+public:
+    enum class TuningRule : uint8_t {ZieglerNichols, TyreusLuyben};
+    enum class State : uint8_t {Idle, Running, Finished, Failed};
+
+    struct Gains {
+        float Kp = 0.0f;
+        float Ki = 0.0f;
+        float Kd = 0.0f;
+    };
+
+    RelayAutoTuner() = default;
+
+    /** Start relay experiment
+     * @param setpoint measurement to oscillate around
+     * @param bias output at centre of relay
+     * @param amplitude relay output step (output swings bias +/- amplitude)
+     * @param hysteresis measurement band around setpoint without switching (noise rejection)
+     * @param cycles number of limit cycles averaged, after one cycle settling
+     * @param rule tuning rule applied to Ku and Tu
+     */
+    void start(float setpoint, float bias, float amplitude, float hysteresis = 0.5f,
+               unsigned int cycles = 4, TuningRule rule = TuningRule::ZieglerNichols);
+
+    /** Start relay with bias at setpoint, limited so that bias +/- amplitude stays within output range
+     * @param setpoint measurement to oscillate around, also the bias when it is within range
+     * @param minOutput lowest output the relay may apply
+     * @param maxOutput highest output the relay may apply
+     */
+    void startWithin(float setpoint, float amplitude, float minOutput, float maxOutput, float hysteresis = 0.5f,
+                     unsigned int cycles = 4, TuningRule rule = TuningRule::ZieglerNichols);
+
+    /** Step relay, return output to apply
+     * @param measurement process variable
+     * @param time_us current time in microseconds
+     */
+    float update(float measurement, uint32_t time_us);
+
+    /** Step relay and hand over to pid in the step the experiment ends
+     * Finished: tuned gains replace gains and gain schedule of pid
+     * Finished or failed: pid restarts from the relay output less feedforward, without bump
+     * @param pid controller taking over, left untouched while relay is running
+     * @param feedforward part of output added outside pid
+     * @return output to apply
+     */
+    float update(float measurement, uint32_t time_us, PIDcontrol& pid, float feedforward = 0.0f);
+
+    void abort();
+
+    State getState() const { return _state; }
+    bool isRunning() const { return _state == State::Running; }
+    bool isFinished() const { return _state == State::Finished; }
+
+    /** Gains computed from the limit cycle, valid when finished */
+    Gains getGains() const { return _gains; }
+    float getUltimateGain() const { return _ultimateGain; }
+    float getUltimatePeriod() const { return _ultimatePeriod; }    // seconds
+
+    /** Fail if relay does not switch within timeout (default 10 s) */
+    void setTimeout(uint32_t timeout_us);
+
+private:
+    void completeCycle(uint32_t time_us);
+    void computeGains();
+
+    State _state = State::Idle;
+    TuningRule _rule = TuningRule::ZieglerNichols;
+    float _setpoint = 0.0f;
+    float _bias = 0.0f;
+    float _amplitude = 0.0f;
+    float _hysteresis = 0.0f;
+    unsigned int _cycles = 0;
+    uint32_t _timeout_us = 10000000;
+
+    bool _relayHigh = true;
+    bool _hasSwitched = false;
+    uint32_t _lastSwitchTime = 0;
+    uint32_t _cycleStartTime = 0;
+    unsigned int _cycleCount = 0;       // completed cycles, first one is discarded
+    float _cycleMax = 0.0f;
+    float _cycleMin = 0.0f;
+    float _sumAmplitude = 0.0f;
+    float _sumPeriod = 0.0f;
+
+    float _ultimateGain = 0.0f;
+    float _ultimatePeriod = 0.0f;
+    Gains _gains;
+};
+
+#endif //RELAYAUTOTUNER_H
@@ -0,0 +1,41 @@
+#include "StallDetector.h"
+
+void StallDetector::setThresholds(float minDuty, float speedRatio, uint32_t overloadTime_us, uint32_t edgeTimeout_us)
+{
+    _minDuty = minDuty;
+    _speedRatio = speedRatio;
+    _overloadTime_us = overloadTime_us;
+    _edgeTimeout_us = edgeTimeout_us;
+    _loaded = false;
+}
+
+StallDetector::Fault StallDetector::update(float duty, float expectedSpeed, float speed, uint32_t time_us,
+                                           uint32_t sinceEdge_us)
+{
+    // within deadband motor may rest, nothing to compare
+    if (_minDuty <= 0 || duty < _minDuty || expectedSpeed <= 0) {
+        _loaded = false;
+        return Fault::None;
+    }
+    if (!_loaded) {
+        _loaded = true;
+        _loadedSince = _slowSince = time_us;
+    }
+    if (speed >= _speedRatio * expectedSpeed) _slowSince = time_us;
+
+    if (time_us - _loadedSince >= _edgeTimeout_us && sinceEdge_us >= _edgeTimeout_us) return Fault::Stall;
+    if (time_us - _slowSince >= _overloadTime_us) return Fault::Overload;
+    return Fault::None;
+}
+
+float StallDetector::limit(float duty, float expectedSpeed, float speed, uint32_t time_us, uint32_t sinceEdge_us)
+{
+    if (_fault == Fault::None) _fault = update(duty, expectedSpeed, speed, time_us, sinceEdge_us);
+    return _fault == Fault::None ? duty : 0.0f;
+}
+
+void StallDetector::clear()
+{
+    _fault = Fault::None;
+    reset();
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#ifndef STALLDETECTOR_H
+#define STALLDETECTOR_H
+
+#include <cstdint>
+
+/** Detect jammed or overloaded motor by comparing applied duty with speed it should give
+ * Motor is loaded while duty is at or above minDuty and expected speed (from a measured duty to speed
+ * curve, see expectedSpeed()) is above 0, checked over the whole duty range so a jam at low reference is seen
+ * Stall: loaded and no encoder edge for edgeTimeout, i.e. jammed
+ * Overload: loaded and speed below speedRatio of expected speed for overloadTime, i.e. moving but cannot follow
+ * limit() latches the fault and cuts duty to 0 in the period it is detected, until clear()
+ * Free of mbed, called at control rate
+ *
+ * Example:
+ * StallDetector detector;
+ * duty = detector.limit(duty, StallDetector::expectedSpeed(duty, linearisation, feedforward), speed, time_us,
+ *                       sinceEdge_us);
+ */
+class StallDetector {
+public:
+    /** None, Stall: no encoder edge, Overload: speed too low for duty */
+    enum class Fault {None = 0, Stall, Overload};
+
+    StallDetector() = default;
+
+    /** @param minDuty duty (0 - 100) from which motor has to turn, 0 to disable
+     * @param speedRatio fraction of expected speed below which motor is overloaded
+     * @param overloadTime_us time below speedRatio of expected speed before Overload
+     * @param edgeTimeout_us time without encoder edge before Stall
+     */
+    void setThresholds(float minDuty, float speedRatio, uint32_t overloadTime_us, uint32_t edgeTimeout_us);
+
+    /** Check one control step
+     * @param duty duty applied (0 - 100)
+     * @param expectedSpeed speed the duty gives unloaded (0 - 100)
+     * @param speed measured speed along driven direction, negative if back-driven
+     * @param time_us current time
+     * @param sinceEdge_us time since last encoder edge
+     * @return fault detected at this step, None otherwise
+     */
+    Fault update(float duty, float expectedSpeed, float speed, uint32_t time_us, uint32_t sinceEdge_us);
+
+    /** Check one control step and latch a fault
+     * @return duty to write, 0 from the step a fault is detected until clear()
+     */
+    float limit(float duty, float expectedSpeed, float speed, uint32_t time_us, uint32_t sinceEdge_us);
+
+    /** Fault latched by limit(), None if running */
+    Fault getFault() const { return _fault; }
+
+    /** Release latched fault and restart timing */
+    void clear();
+
+    /** Restart timing, e.g. after fault is cleared */
+    void reset() { _loaded = false; }
+
+    /** Unloaded speed (0 - 100) at duty from calibrated duty to speed curve, else from feedforward curve
+     * (reference to duty) read backwards. 0 without either, which keeps detection inactive: a motor whose
+     * deadband lies above minDuty rests at duty a guessed curve expects to turn it, and would trip
+     * @tparam Linearisation table of duty to speed, e.g. DutyCalibrator::Table
+     * @tparam Feedforward table of speed to duty
+     */
+    template<typename Linearisation, typename Feedforward>
+    static float expectedSpeed(float duty, const Linearisation& linearisation, const Feedforward& feedforward)
+    {
+        if (!linearisation.empty()) return linearisation.interpolate(duty);
+        if (!feedforward.empty()) return feedforward.inverse(duty);
+        return 0.0f;
+    }
+
+    float getMinDuty() const { return _minDuty; }
+    bool isLoaded() const { return _loaded; }
+
+private:
+    float _minDuty = 20.0f;
+    float _speedRatio = 0.25f;
+    uint32_t _overloadTime_us = 1000000;
+    uint32_t _edgeTimeout_us = 300000;
+    bool _loaded = false;
+    Fault _fault = Fault::None;
+    uint32_t _loadedSince = 0;          // time motor became loaded (us)
+    uint32_t _slowSince = 0;            // time speed was last at or above speedRatio of expected while loaded (us)
+};
+
+#endif //STALLDETECTOR_H
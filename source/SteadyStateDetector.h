@@ -0,0 +1,121 @@
+#pragma once
+
+#ifndef STEADYSTATEDETECTOR_H
+#define STEADYSTATEDETECTOR_H
+
+#include <array>
+#include <cmath>
+
+/** Windowed steady state detector
+ * Keeps last N samples (e.g. speed error) in a ring with running sums of x, x^2 and i*x,
+ * so mean, variance and least squares slope are O(1) per sample
+ * Steady when window is full and, within tolerance band,
+ * |mean| < tolerance, standard deviation < tolerance / 2 and drift (slope over window) < tolerance
+ * Running sums are recomputed once per N samples so rounding error cannot drift
+ *
+ * Example:
+ * SteadyStateDetector<8> detector(1.0f);
+ * bool steady = detector.addSample(error);
+ * @tparam N window length (samples)
+ */
+template<int N>
+class SteadyStateDetector {
+    static_assert(N > 2, "Window has to be longer than 2 samples");
+public:
+    explicit SteadyStateDetector(float tolerance = 1.0f) : _tolerance(tolerance) {}
+
+    /** Add sample and return if steady */
+    bool addSample(float sample);
+
+    void reset();
+    void setTolerance(float tolerance) { _tolerance = tolerance; }
+
+    bool isSteady() const { return _steady; }
+    int size() const { return _count; }
+    float getMean() const { return _count > 0 ? _sum / _count : 0.0f; }
+    float getVariance() const;
+    float getSlope() const;             // change per sample, least squares over window
+
+private:
+    void resum();
+
+    float _tolerance;
+    std::array<float, N> _samples{};
+    int _head = 0;                      // index of oldest sample once window is full
+    int _count = 0;
+    float _sum = 0.0f;                  // sum of x
+    float _sumSquare = 0.0f;            // sum of x^2
+    float _sumWeighted = 0.0f;          // sum of i * x, i = 0 for oldest sample
+    bool _steady = false;
+};
+
+
+template<int N>
+bool SteadyStateDetector<N>::addSample(float sample)
+{
+    if (_count < N) {
+        _sumWeighted += _count * sample;
+        _samples[_count++] = sample;
+        _sum += sample;
+        _sumSquare += sample * sample;
+    }
+    else {
+        // drop oldest, every other sample moves one index down
+        float oldest = _samples[_head];
+        _sumWeighted += (N - 1) * sample - (_sum - oldest);
+        _sum += sample - oldest;
+        _sumSquare += sample * sample - oldest * oldest;
+        _samples[_head] = sample;
+        _head = (_head + 1 == N) ? 0 : _head + 1;
+        if (_head == 0) resum();
+    }
+
+    _steady = _count == N
+              && std::abs(getMean()) < _tolerance
+              && getVariance() < _tolerance * _tolerance / 4
+              && std::abs(getSlope()) * (N - 1) < _tolerance;
+    return _steady;
+}
+
+template<int N>
+void SteadyStateDetector<N>::reset()
+{
+    _head = 0;
+    _count = 0;
+    _sum = _sumSquare = _sumWeighted = 0.0f;
+    _steady = false;
+}
+
+template<int N>
+float SteadyStateDetector<N>::getVariance() const
+{
+    if (_count < 2) return 0.0f;
+    float mean = _sum / _count;
+    float variance = _sumSquare / _count - mean * mean;
+    return variance > 0 ? variance : 0.0f;
+}
+
+template<int N>
+float SteadyStateDetector<N>::getSlope() const
+{
+    if (_count < 2) return 0.0f;
+    // least squares over i = 0 .. n-1: slope = (n * sum(i*x) - sum(i) * sum(x)) / (n * sum(i^2) - sum(i)^2)
+    float n = _count;
+    float sumIndex = n * (n - 1) / 2;
+    float sumIndexSquare = (n - 1) * n * (2 * n - 1) / 6;
+    return (n * _sumWeighted - sumIndex * _sum) / (n * sumIndexSquare - sumIndex * sumIndex);
+}
+
+template<int N>
+void SteadyStateDetector<N>::resum()
+{
+    // _head is 0, ring is in chronological order
+    _sum = _sumSquare = _sumWeighted = 0.0f;
+    for (int i = 0; i < N; i++) {
+        _sum += _samples[i];
+        _sumSquare += _samples[i] * _samples[i];
+        _sumWeighted += i * _samples[i];
+    }
+}
+
+#endif //STEADYSTATEDETECTOR_H
@@ -0,0 +1,52 @@
+#include "TimerPulseCounter.h"
+#include "pinmap.h"
+
+TimerPulseCounter::TimerPulseCounter(PinName encoderA, PinName encoderB, EncodeType encodeType, uint8_t inputFilter)
+        : _encodeType(encodeType), _inputFilter(inputFilter & 0xF), _count(encodeType, encoderB != PA_8)
+{
+    if (!isSupported(encoderA, encoderB)) {
+        error("TimerPulseCounter: encoder must be connected to PA_8 and PA_9 (TIM1)\n");
+    }
+}
+
+bool TimerPulseCounter::isSupported(PinName encoderA, PinName encoderB)
+{
+    return (encoderA == PA_8 && encoderB == PA_9) || (encoderA == PA_9 && encoderB == PA_8);
+}
+
+void TimerPulseCounter::start()
+{
+    // route PA_8 and PA_9 to TIM1 CH1 and CH2
+    RCC->APB2ENR |= RCC_APB2ENR_TIM1EN;
+    pin_function(PA_8, STM_PIN_DATA(STM_MODE_AF_PP, GPIO_PULLUP, GPIO_AF1_TIM1));
+    pin_function(PA_9, STM_PIN_DATA(STM_MODE_AF_PP, GPIO_PULLUP, GPIO_AF1_TIM1));
+
+    TIM1->CR1 = 0;
+    TIM1->PSC = 0;
+    TIM1->ARR = 0xFFFF;
+    // CH1 and CH2 as input on TI1 and TI2 with filter, non-inverted polarity
+    TIM1->CCMR1 = TIM_CCMR1_CC1S_0 | TIM_CCMR1_CC2S_0
+            | (_inputFilter << TIM_CCMR1_IC1F_Pos) | (_inputFilter << TIM_CCMR1_IC2F_Pos);
+    TIM1->CCER = 0;
+    // X4 counts edges of both channels (encoder mode 3), X1 and X2 count edges of TI1 only (encoder mode 1)
+    TIM1->SMCR = (_encodeType == EncodeType::X4) ? (TIM_SMCR_SMS_0 | TIM_SMCR_SMS_1) : TIM_SMCR_SMS_0;
+    TIM1->EGR = TIM_EGR_UG;
+    TIM1->CNT = 0;
+    _count.start(0);
+    TIM1->CR1 = TIM_CR1_CEN;
+}
+
+void TimerPulseCounter::stop()
+{
+    TIM1->CR1 = 0;
+}
+
+long TimerPulseCounter::peekPulses() const
+{
+    return _count.peekPulses((uint16_t)TIM1->CNT);
+}
+
+long TimerPulseCounter::takePulses()
+{
+    return _count.takePulses((uint16_t)TIM1->CNT);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#ifndef TIMERPULSECOUNTER_H
+#define TIMERPULSECOUNTER_H
+
+#include <mbed.h>
+#include "PulseCounter.h"
+#include "QuadratureDecoder.h"
+
+/** Count encoder pulses with the STM32 TIM1 encoder interface
+ * Encoder channels must be connected to PA_8 (TIM1_CH1) and PA_9 (TIM1_CH2)
+ * Edges are counted by the timer itself, no interrupt is taken per edge
+ * takePulses() must be called before 32767 pulses are accumulated (16-bit counter)
+ * Direction is decoded by the timer, invalid transitions are not reported
+ *
+ * Example:
+ * TimerPulseCounter counter(PA_9, PA_8, EncodeType::X4);
+ */
+class TimerPulseCounter : public PulseCounter {
+public:
+    TimerPulseCounter() = delete;
+    TimerPulseCounter(PinName encoderA, PinName encoderB, EncodeType encodeType = EncodeType::X4,
+            uint8_t inputFilter = 0x3);
+
+    void start() override;
+    void stop() override;
+    long takePulses() override;
+    long peekPulses() const override;
+
+    /** Check if the pin pair is routed to TIM1 channel 1 and 2 */
+    static bool isSupported(PinName encoderA, PinName encoderB);
+
+private:
+    EncodeType _encodeType;
+    uint8_t _inputFilter;           // TIM1 input capture filter (0x0 - 0xF), reject short glitches on encoder lines
+    CounterUnwrapper _count;        // TIM1 counts up when CH1 leads, inverted if encoder B is not on CH1
+};
+
+#endif //TIMERPULSECOUNTER_H
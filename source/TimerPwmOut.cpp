@@ -0,0 +1,52 @@
+#include "TimerPwmOut.h"
+
+TimerPwmOut::TimerPwmOut(PinName pin) : _pwm(pin), _direct(isSupported(pin))
+{
+}
+
+bool TimerPwmOut::isSupported(PinName pin)
+{
+    return pin == PA_15;
+}
+
+uint32_t TimerPwmOut::timerClock()
+{
+    // APB1 timers run at twice PCLK1 unless APB1 is undivided
+    uint32_t clock = HAL_RCC_GetPCLK1Freq();
+    if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_CFGR_PPRE1_DIV1) clock *= 2;
+    return clock;
+}
+
+unsigned int TimerPwmOut::setFrequency(float frequency)
+{
+    const float minFrequency = 16;      // period must fit 16-bit timer at 1 us tick
+    if (frequency < minFrequency) frequency = minFrequency;
+
+    // PwmOut sets up pin, clock and channel, TIM2 (32-bit) is then reprogrammed to count at full clock
+    auto period_us = (unsigned int)(1000000 / frequency + 0.5f);
+    _pwm.period_us(period_us > 0 ? period_us : 1);
+    if (!_direct) {
+        _steps = period_us > 0 ? period_us : 1;
+        return _steps;
+    }
+    auto steps = (unsigned int)(timerClock() / frequency + 0.5f);
+    _steps = steps > 1 ? steps : 1;
+    TIM2->CR1 |= TIM_CR1_ARPE;
+    TIM2->PSC = 0;
+    TIM2->ARR = _steps - 1;
+    TIM2->CCR1 = 0;
+    TIM2->EGR = TIM_EGR_UG;             // load prescaler and period now
+    return _steps;
+}
+
+void TimerPwmOut::write(float duty)
+{
+    if (duty < 0) duty = 0;
+    else if (duty > 1) duty = 1;
+    if (!_direct) {
+        _pwm.write(duty);
+        return;
+    }
+    // compare is preloaded, changes at update event without glitch
+    TIM2->CCR1 = (uint32_t)(duty * _steps + 0.5f);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#ifndef TIMERPWMOUT_H
+#define TIMERPWMOUT_H
+
+#include <mbed.h>
+
+/** PWM output with duty resolution of the timer clock
+ * PwmOut counts in 1 us ticks, i.e. only 100 duty steps at 10 kHz
+ * On PA_15 (TIM2_CH1) the period is programmed in TIM2 clock cycles instead, 100 MHz on NUCLEO_F411RE
+ * gives 10000 steps at 10 kHz. Other pins fall back to PwmOut with 1 us steps
+ * Pin, clock and PWM mode are set up by PwmOut, only prescaler, auto-reload and compare are written here
+ *
+ * Example:
+ * TimerPwmOut pwm(PA_15);
+ * unsigned int steps = pwm.setFrequency(10000);  // 10000 on TIM2
+ * pwm.write(0.5f);
+ */
+class TimerPwmOut {
+public:
+    explicit TimerPwmOut(PinName pin);
+
+    /** Set period to nearest whole number of counter steps
+     * @param frequency in Hz, at least 16 Hz (16-bit period of PwmOut fallback)
+     * @return duty steps per period
+     */
+    unsigned int setFrequency(float frequency);
+
+    /** Write duty (0 - 1) rounded to nearest step, takes effect at next period */
+    void write(float duty);
+
+    unsigned int getSteps() const { return _steps; }
+
+    /** Check if pin is routed to TIM2 channel 1 */
+    static bool isSupported(PinName pin);
+
+private:
+    static uint32_t timerClock();   // TIM2 counter clock (Hz)
+
+    PwmOut _pwm;
+    bool _direct;                   // TIM2 programmed directly
+    unsigned int _steps = 20000;    // counter steps per period (mbed default 20 ms at 1 us)
+};
+
+#endif //TIMERPWMOUT_H
@@ -0,0 +1,62 @@
+#include "TrajectoryGenerator.h"
+#include <cmath>
+
+TrajectoryGenerator::TrajectoryGenerator(float maxAcceleration, float maxJerk)
+{
+    setLimits(maxAcceleration, maxJerk);
+}
+
+void TrajectoryGenerator::setLimits(float maxAcceleration, float maxJerk)
+{
+    _maxAcceleration = maxAcceleration > 0 ? maxAcceleration : 0.0f;
+    _maxJerk = maxJerk > 0 ? maxJerk : 0.0f;
+}
+
+void TrajectoryGenerator::reset(float value)
+{
+    _setpoint = _target = value;
+    _acceleration = 0.0f;
+}
+
+float TrajectoryGenerator::update(float target, float timeStep_s)
+{
+    _target = target;
+    if (_maxAcceleration == 0) {
+        reset(target);
+        return _setpoint;
+    }
+    if (timeStep_s <= 0) return _setpoint;
+
+    float remaining = target - _setpoint;
+    float maxChange = _maxJerk * timeStep_s;
+
+    // fastest acceleration from which jerk limit can still bring acceleration to 0 at target
+    float desired = _maxAcceleration;
+    float direction = remaining > 0 ? 1.0f : -1.0f;
+    if (_maxJerk > 0) {
+        // setpoint still travels this far while acceleration is ramped down to 0
+        float rampDown = _acceleration * std::abs(_acceleration) / (2 * _maxJerk);
+        if ((remaining - rampDown) * direction < 0) direction = -direction;    // too late, bring acceleration down
+        else {
+            float braking = std::sqrt(2 * _maxJerk * std::abs(remaining));
+            if (braking < desired) desired = braking;
+        }
+    }
+    desired *= direction;
+
+    if (_maxJerk > 0) {
+        if (desired > _acceleration + maxChange) desired = _acceleration + maxChange;
+        else if (desired < _acceleration - maxChange) desired = _acceleration - maxChange;
+    }
+    float previous = _acceleration;
+    _acceleration = desired;
+    _setpoint += _acceleration * timeStep_s;
+
+    // land on target instead of dithering around it, unless acceleration is too high to drop in one step
+    float crossed = (target - _setpoint) * (remaining > 0 ? 1.0f : -1.0f);
+    if (crossed <= 0 && (_maxJerk == 0 || std::abs(previous) <= maxChange)) {
+        _setpoint = target;
+        _acceleration = 0.0f;
+    }
+    return _setpoint;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#ifndef TRAJECTORYGENERATOR_H
+#define TRAJECTORYGENERATOR_H
+
+/** Jerk limited (S-curve) setpoint generator
+ * Setpoint moves toward target with acceleration bounded by maxAcceleration and
+ * change of acceleration bounded by maxJerk. Acceleration follows sqrt(2 * maxJerk * remaining),
+ * so it reaches zero exactly when setpoint reaches target, i.e. shortest ramp within both limits
+ * Target may change at any time, setpoint stays continuous in value and acceleration
+ * Free of mbed, update() is called at control rate with measured period
+ *
+ * Example:
+ * TrajectoryGenerator profile(20.0f, 100.0f);     // 20 unit/s, 100 unit/s^2
+ * setpoint = profile.update(target, timeStep_s);
+ */
+class TrajectoryGenerator {
+public:
+    /** @param maxAcceleration unit/s, 0 to disable limits (setpoint = target)
+     * @param maxJerk unit/s^2, 0 for acceleration limit only (trapezoidal ramp)
+     */
+    explicit TrajectoryGenerator(float maxAcceleration = 0, float maxJerk = 0);
+
+    void setLimits(float maxAcceleration, float maxJerk);
+
+    /** Step setpoint toward target
+     * @param target final value
+     * @param timeStep_s period since last update (s)
+     * @return setpoint
+     */
+    float update(float target, float timeStep_s);
+
+    /** Restart from value at rest, e.g. measured speed */
+    void reset(float value = 0);
+
+    float getSetpoint() const { return _setpoint; }
+    float getAcceleration() const { return _acceleration; }
+    float getMaxAcceleration() const { return _maxAcceleration; }
+    bool isSettled() const { return _setpoint == _target && _acceleration == 0; }
+
+private:
+    float _maxAcceleration;
+    float _maxJerk;
+    float _setpoint = 0.0f;
+    float _acceleration = 0.0f;
+    float _target = 0.0f;
+};
+
+#endif //TRAJECTORYGENERATOR_H
@@ -0,0 +1,44 @@
+#include "TrapezoidalMove.h"
+#include <cmath>
+
+bool TrapezoidalMove::start(float distance, float speed, float acceleration)
+{
+    if (distance <= 0 || speed <= 0 || acceleration <= 0) return false;
+    _distance = distance;
+    _acceleration = acceleration;
+    // triangular profile if cruise speed cannot be reached within half the distance
+    _peakSpeed = std::sqrt(distance * acceleration);
+    if (_peakSpeed > speed) _peakSpeed = speed;
+    _accelerationTime = _peakSpeed / acceleration;
+    float cruiseTime = (distance - _peakSpeed * _accelerationTime) / _peakSpeed;
+    _duration = 2 * _accelerationTime + cruiseTime;
+    _time = 0.0f;
+    _position = 0.0f;
+    _speed = 0.0f;
+    _running = true;
+    return true;
+}
+
+void TrapezoidalMove::update(float timeStep_s)
+{
+    if (!_running) return;
+    _time += timeStep_s;
+    if (_time >= _duration) {
+        _time = _duration;
+        _position = _distance;
+        _speed = 0.0f;
+    }
+    else if (_time < _accelerationTime) {
+        _speed = _acceleration * _time;
+        _position = _speed * _time / 2;
+    }
+    else if (_time > _duration - _accelerationTime) {
+        float remaining = _duration - _time;
+        _speed = _acceleration * remaining;
+        _position = _distance - _speed * remaining / 2;
+    }
+    else {
+        _speed = _peakSpeed;
+        _position = _peakSpeed * (_time - _accelerationTime / 2);
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#ifndef TRAPEZOIDALMOVE_H
+#define TRAPEZOIDALMOVE_H
+
+/** Trapezoidal (or triangular when too short to reach speed) move profile
+ * Accelerates at acceleration to speed, cruises, then decelerates to stop exactly at distance
+ * Profile is evaluated from elapsed time, so position of profile does not drift with irregular steps
+ * Free of mbed, update() is called at control rate with measured period
+ *
+ * Example:
+ * TrapezoidalMove move;
+ * move.start(300.0f, 5.0f, 10.0f);     // 300 mm at 5 mm/s, 10 mm/s^2
+ * move.update(timeStep_s);             // then read getPosition() and getSpeed()
+ */
+class TrapezoidalMove {
+public:
+    TrapezoidalMove() = default;
+
+    /** Plan move from rest at 0 to distance
+     * @param distance travel, must be positive
+     * @param speed cruise speed, must be positive
+     * @param acceleration acceleration and deceleration, must be positive
+     * @return false if move is rejected
+     */
+    bool start(float distance, float speed, float acceleration);
+
+    /** Advance profile by timeStep_s */
+    void update(float timeStep_s);
+
+    void abort() { _running = false; }
+
+    bool isRunning() const { return _running; }
+    bool isFinished() const { return _time >= _duration; }
+    float getPosition() const { return _position; }    // planned position
+    float getSpeed() const { return _speed; }          // planned speed
+    float getDistance() const { return _distance; }
+    float getDuration() const { return _duration; }    // seconds
+
+private:
+    float _distance = 0.0f;
+    float _acceleration = 0.0f;
+    float _peakSpeed = 0.0f;
+    float _accelerationTime = 0.0f;     // time to reach peak speed (s)
+    float _duration = 0.0f;             // total time of move (s)
+    float _time = 0.0f;
+    float _position = 0.0f;
+    float _speed = 0.0f;
+    bool _running = false;
+};
+
+#endif //TRAPEZOIDALMOVE_H
@@ -0,0 +1,72 @@
+#pragma once
+
+#ifndef FAKEPULSECOUNTER_H
+#define FAKEPULSECOUNTER_H
+
+#include "PulseCounter.h"
+#include "QuadratureDecoder.h"
+
+/** Host stand-in for InterruptPulseCounter
+ * Encoder lines are driven by the test instead of pins, edges go through the same QuadratureDecoder
+ * as the ISR backend, so decoding, count, edge time and compare behave exactly as on target
+ *
+ * Example:
+ * FakePulseCounter counter(EncodeType::X4);
+ * counter.start();
+ * counter.rotate(100, 0, 50);     // 100 X4 edges forward, 50 us apart
+ * long pulses = counter.takePulses();
+ */
+class FakePulseCounter : public PulseCounter {
+public:
+    explicit FakePulseCounter(EncodeType encodeType = EncodeType::X4, bool timestampEdges = true)
+            : _encodeType(encodeType), _decoder(timestampEdges) {}
+
+    void start() override { _running = true; _decoder.start(_state); }
+    void stop() override { _running = false; }
+    long takePulses() override { return _decoder.takePulses(); }
+    long peekPulses() const override { return _decoder.peekPulses(); }
+    bool armCompare(long compare, int8_t direction, CompareHandler handler, void* context) override {
+        _decoder.armCompare(compare, direction, handler, context);
+        return true;
+    }
+    void disarmCompare() override { _decoder.disarmCompare(); }
+    unsigned long getInvalidTransitions() const override { return _decoder.getInvalidTransitions(); }
+    bool hasEdgeTime() const override { return _decoder.hasEdgeTime(); }
+    EdgeTime getEdgeTime() const override { return _decoder.getEdgeTime(); }
+    uint32_t getEdgeSequence() const override { return _decoder.getEdgeSequence(); }
+
+    /** Set level of both lines, (A << 1) | B, edges are counted as the ISR backend would */
+    void setState(uint8_t state, unsigned long long time_us = 0) {
+        state &= 0x3;
+        uint8_t changed = _state ^ state;
+        bool riseA = (changed & 0x2) && (state & 0x2);
+        _state = state;
+        if (!_running || changed == 0) return;
+        switch (_encodeType) {
+            case EncodeType::X1: if (riseA) _decoder.decodeEdgeA(state, time_us); break;
+            case EncodeType::X2: if (changed & 0x2) _decoder.decodeEdgeA(state, time_us); break;
+            case EncodeType::X4: _decoder.decodeTransition(state, time_us); break;
+        }
+    }
+
+    /** Turn encoder by X4 edges (positive when B leads A), first edge at time_us then every interval_us */
+    void rotate(long edges, unsigned long long time_us = 0, unsigned long interval_us = 0) {
+        // forward sequence 00 -> 01 -> 11 -> 10 -> 00
+        static const uint8_t sequence[4] = {0x0, 0x1, 0x3, 0x2};
+        for (long i = 0; i < (edges >= 0 ? edges : -edges); i++) {
+            _phase = (_phase + (edges >= 0 ? 1 : 3)) & 0x3;
+            setState(sequence[_phase], time_us + i * interval_us);
+        }
+    }
+
+    uint8_t getState() const { return _state; }
+
+private:
+    EncodeType _encodeType;
+    QuadratureDecoder _decoder;
+    bool _running = false;
+    uint8_t _state = 0;
+    uint8_t _phase = 0;         // index of _state in forward sequence
+};
+
+#endif //FAKEPULSECOUNTER_H
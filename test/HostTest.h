@@ -0,0 +1,55 @@
+#pragma once
+
+#ifndef HOSTTEST_H
+#define HOSTTEST_H
+
+#include <cstdio>
+#include <cmath>
+#include <chrono>
+
+/** Minimal host test helpers, no framework needed
+ * CHECK(condition) and CHECK_NEAR(value, expected, tolerance) report the failing line and keep going,
+ * return hostTestResult() from main() so ctest sees the failure
+ */
+inline int& hostTestFailures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition) \
+    do { if (!(condition)) { std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+                             hostTestFailures()++; } } while (0)
+
+#define CHECK_NEAR(value, expected, tolerance) \
+    do { double v_ = (value), e_ = (expected); \
+         if (!(std::fabs(v_ - e_) <= (tolerance))) { \
+             std::printf("%s:%d: CHECK_NEAR(%s) = %g, expected %g +/- %g\n", __FILE__, __LINE__, #value, v_, e_, \
+                         (double)(tolerance)); \
+             hostTestFailures()++; } } while (0)
+
+inline int hostTestResult()
+{
+    if (hostTestFailures() == 0) std::printf("passed\n");
+    else std::printf("%d check(s) failed\n", hostTestFailures());
+    return hostTestFailures() == 0 ? 0 : 1;
+}
+
+/** Nanoseconds per call of func averaged over iterations, host wall clock */
+template<typename Function>
+double nanosecondsPerCall(long iterations, Function func)
+{
+    auto begin = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++) func(i);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - begin).count() / iterations;
+}
+
+/** Keep value alive so the optimiser cannot drop the benchmarked work */
+template<typename T>
+inline void keep(T const& value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+#endif //HOSTTEST_H
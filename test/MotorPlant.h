@@ -0,0 +1,61 @@
+#pragma once
+
+#ifndef MOTORPLANT_H
+#define MOTORPLANT_H
+
+#include <cstddef>
+#include <deque>
+
+/** Simulated DC motor for host tests, first order lag plus dead time (FOPDT) with static friction
+ * Input is duty (0 - 100), output is speed (0 - 100 of rated RPM)
+ * speed -> gain * (duty - deadband) with time constant, duty reaches the motor after delay
+ * jam() holds the shaft at standstill whatever the duty
+ *
+ * Example:
+ * MotorPlant plant(1.2f, 0.5f, 0.05f, 15.0f);
+ * float speed = plant.step(duty, 0.01f);
+ */
+class MotorPlant {
+public:
+    MotorPlant(float gain, float timeConstant, float delay = 0.0f, float deadband = 0.0f)
+            : _gain(gain), _timeConstant(timeConstant), _delaySteps((std::size_t)(delay / substep + 0.5f)),
+              _deadband(deadband) {}
+
+    /** Apply duty for dt, integrated in substeps of at most 1 ms
+     * @return speed at end of step
+     */
+    float step(float duty, float dt) {
+        float elapsed = 0.0f;
+        while (elapsed < dt - 1e-7f) {
+            float h = dt - elapsed < substep ? dt - elapsed : substep;
+            // one input per substep, delayed by whole substeps
+            _inputs.push_back(duty);
+            float delayed = 0.0f;
+            if (_inputs.size() > _delaySteps) {
+                delayed = _inputs.front();
+                _inputs.pop_front();
+            }
+            float drive = delayed > _deadband ? _gain * (delayed - _deadband) : 0.0f;
+            _speed += (drive - _speed) * h / (_timeConstant + h);
+            if (_jammed) _speed = 0.0f;
+            elapsed += h;
+        }
+        return _speed;
+    }
+
+    void jam(bool jammed = true) { _jammed = jammed; }
+    float speed() const { return _speed; }
+
+private:
+    static constexpr float substep = 0.001f;
+
+    float _gain;
+    float _timeConstant;
+    std::size_t _delaySteps;
+    float _deadband;
+    float _speed = 0.0f;
+    bool _jammed = false;
+    std::deque<float> _inputs;
+};
+
+#endif //MOTORPLANT_H
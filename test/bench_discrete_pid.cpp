@@ -0,0 +1,43 @@
+// Host benchmark of PID step cost: PIDcontrol against DiscretePID at nominal period (precomputed coefficients)
+// and at irregular period (coefficients computed at the step), float and Q16.16
+// On target the same paths are measured in cycles by measureControllerCycles() (ControllerBenchmark.h)
+
+#include "HostTest.h"
+#include "DiscretePID.h"
+#include "PIDcontrol.h"
+
+namespace {
+    const long iterations = 10000000;
+
+    float error(long i) { return (float)((i * 7919) % 200) * 0.1f - 10.0f; }
+
+    template<typename T>
+    void benchmark(const char* name)
+    {
+        DiscretePID<T, 1000> pid(0.2f, 2.0f, 0.08f);
+        pid.setOutputLimits(T(0), T(100));
+        T output = T(0);
+        double nominal = nanosecondsPerCall(iterations, [&](long i) {
+            output = pid.step(T(error(i)), T(50.0f), 1000);
+            keep(output);
+        });
+        double irregular = nanosecondsPerCall(iterations, [&](long i) {
+            output = pid.step(T(error(i)), T(50.0f), 1500 + (uint32_t)(i & 255));
+            keep(output);
+        });
+        std::printf("DiscretePID<%s>: %.2f ns nominal, %.2f ns irregular period\n", name, nominal, irregular);
+    }
+}
+
+int main()
+{
+    PIDcontrol pid(0.2f, 2.0f, 0.08f);
+    pid.setOutputLimits(0.0f, 100.0f);
+    double runtime = nanosecondsPerCall(iterations, [&](long i) {
+        keep(pid.compensateSignal(error(i), 50.0f, 1000));
+    });
+    std::printf("PIDcontrol: %.2f ns\n", runtime);
+    benchmark<float>("float");
+    benchmark<Q16_16>("Q16_16");
+    return 0;
+}
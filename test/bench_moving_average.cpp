@@ -0,0 +1,46 @@
+// Host benchmark of MovingAverage (ring buffer, running sum) against the previous std::deque implementation
+// that re-summed all N elements at every AddData(), at the window lengths used in the firmware (21 and 11)
+
+#include "HostTest.h"
+#include "MovingAverage.h"
+#include <deque>
+
+namespace {
+    /** Previous MovingAverage, kept here as reference */
+    template<typename T, int N>
+    class DequeMovingAverage {
+    public:
+        void AddData(T data) {
+            T sum = 0;
+            if (_dataList.size() >= N) _dataList.pop_front();
+            _dataList.push_back(data);
+            for (auto &val: _dataList) sum += val;
+            _value = _dataList.size() < N ? sum / _dataList.size() : sum * N_recipro;
+        }
+        T getValue() const { return _value; }
+    private:
+        std::deque<T> _dataList;
+        T _value = 0;
+        const double N_recipro = 1.0 / N;
+    };
+
+    template<int N>
+    void compare(long iterations)
+    {
+        MovingAverage<float, N> ring;
+        DequeMovingAverage<float, N> deque;
+        auto data = [](long i) { return (float)((i * 7919) % 1000) * 0.01f; };
+        double ringTime = nanosecondsPerCall(iterations, [&](long i) { ring.AddData(data(i)); keep(ring.getValue()); });
+        double dequeTime = nanosecondsPerCall(iterations, [&](long i) { deque.AddData(data(i)); keep(deque.getValue()); });
+        std::printf("N = %2d: ring %.2f ns, deque %.2f ns per AddData (%.1fx), final values %f / %f\n",
+                    N, ringTime, dequeTime, dequeTime / ringTime, ring.getValue(), deque.getValue());
+    }
+}
+
+int main()
+{
+    const long iterations = 10000000;
+    compare<21>(iterations);
+    compare<11>(iterations);
+    return 0;
+}
@@ -0,0 +1,57 @@
+// Host benchmark of PIDBank against the same number of separate PIDcontrol objects
+// Both run Positional form with BackCalculation anti-windup on the same errors, cost is per step of all loops
+
+#include <array>
+#include <utility>
+#include "HostTest.h"
+#include "PIDBank.h"
+#include "PIDcontrol.h"
+
+namespace {
+    const long iterations = 2000000;
+
+    float error(long i, std::size_t loop) { return (float)(((i + (long)loop * 31) * 7919) % 200) * 0.1f - 10.0f; }
+
+    /** N controllers with the same gains, PIDcontrol has no default constructor */
+    template<std::size_t N, std::size_t... I>
+    std::array<PIDcontrol, N> makeControllers(std::index_sequence<I...>)
+    {
+        return {{((void)I, PIDcontrol(0.2f, 2.0f, 0.08f))...}};
+    }
+
+    template<std::size_t N>
+    void benchmark()
+    {
+        PIDBank<N> bank;
+        std::array<PIDcontrol, N> pids = makeControllers<N>(std::make_index_sequence<N>());
+        for (std::size_t i = 0; i < N; i++) {
+            bank.setGains(i, 0.2f, 2.0f, 0.08f);
+            bank.setOutputLimits(i, 0.0f, 100.0f);
+            pids[i].setOutputLimits(0.0f, 100.0f);
+        }
+
+        typename PIDBank<N>::Signals errors{}, measurements{};
+        measurements.fill(50.0f);
+        double bankTime = nanosecondsPerCall(iterations, [&](long i) {
+            for (std::size_t loop = 0; loop < N; loop++) errors[loop] = error(i, loop);
+            keep(bank.step(errors, measurements, 1000));
+        });
+        double separateTime = nanosecondsPerCall(iterations, [&](long i) {
+            for (std::size_t loop = 0; loop < N; loop++) {
+                keep(pids[loop].compensateSignal(error(i, loop), 50.0f, 1000));
+            }
+        });
+        std::printf("%2zu loops: PIDBank %6.2f ns, PIDcontrol x %zu %6.2f ns (%.1fx)\n",
+                    N, bankTime, N, separateTime, separateTime / bankTime);
+    }
+}
+
+int main()
+{
+    benchmark<1>();
+    benchmark<2>();
+    benchmark<4>();
+    benchmark<8>();
+    benchmark<16>();
+    return 0;
+}
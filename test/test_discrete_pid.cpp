@@ -0,0 +1,65 @@
+// Host test of DiscretePID: float and Q16.16 agree, small Ki*T keeps integral action in Q16.16,
+// irregular period falls back to coefficients of that period
+
+#include "HostTest.h"
+#include "MotorPlant.h"
+#include "DiscretePID.h"
+
+namespace {
+    void testSmallIntegralCoefficient()
+    {
+        // original firmware gains at 1 kHz, Ki*T = 5e-6 is below Q16.16 resolution
+        DiscretePID<Q16_16, 1000> fixed(0.2f, 0.005f, 0.08f);
+        DiscretePID<float, 1000> reference(0.2f, 0.005f, 0.08f);
+        CHECK(fixed.getCoefficients().c0 != 0);
+        Q16_16 fixedOutput;
+        float floatOutput = 0;
+        for (int i = 0; i < 10000; i++) {       // 10 s at constant error
+            fixedOutput = fixed.step(Q16_16(10.0f), Q16_16(0.0f));
+            floatOutput = reference.step(10.0f, 0.0f);
+        }
+        // bumpless start from 0, so output is the integral action only: 0.005 * 10 * 10 s = 0.5
+        CHECK_NEAR(fixedOutput.toFloat(), 0.5f, 1e-3f);
+        CHECK_NEAR(floatOutput, 0.5f, 2e-3f);   // float sum of 5e-5 steps onto -2 loses a little
+    }
+
+    void testClosedLoop()
+    {
+        DiscretePID<float, 1000> floatPID(0.2f, 2.0f, 0.08f);
+        DiscretePID<Q16_16, 1000> fixedPID(0.2f, 2.0f, 0.08f);
+        floatPID.setOutputLimits(0.0f, 100.0f);
+        fixedPID.setOutputLimits(Q16_16(0), Q16_16(100));
+        MotorPlant floatPlant(1.0f, 0.5f, 0.01f, 10.0f), fixedPlant(1.0f, 0.5f, 0.01f, 10.0f);
+        float floatSpeed = 0, fixedSpeed = 0, maxDifference = 0;
+        for (int i = 0; i < 5000; i++) {
+            float floatOutput = floatPID.step(50.0f - floatSpeed, floatSpeed);
+            float fixedOutput = fixedPID.step(Q16_16(50.0f - fixedSpeed), Q16_16(fixedSpeed)).toFloat();
+            floatSpeed = floatPlant.step(floatOutput, 0.001f);
+            fixedSpeed = fixedPlant.step(fixedOutput, 0.001f);
+            if (std::fabs(floatOutput - fixedOutput) > maxDifference) maxDifference = std::fabs(floatOutput - fixedOutput);
+        }
+        CHECK_NEAR(floatSpeed, 50.0f, 0.5f);
+        CHECK_NEAR(fixedSpeed, 50.0f, 0.5f);
+        CHECK(maxDifference < 0.1f);
+    }
+
+    void testIrregularPeriod()
+    {
+        // pure integrator, a double length step integrates twice as much
+        DiscretePID<float, 1000> pid(0.0f, 1.0f, 0.0f);
+        pid.step(1.0f, 0.0f, 1000);
+        float nominal = pid.step(1.0f, 0.0f, 1050);     // within 1/8, nominal coefficients
+        CHECK_NEAR(nominal, 0.002f, 1e-6f);
+        float irregular = pid.step(1.0f, 0.0f, 2000);
+        CHECK_NEAR(irregular - nominal, 0.002f, 1e-6f);
+        CHECK(pid.step(1.0f, 0.0f, 0) == irregular);     // zero period holds output
+    }
+}
+
+int main()
+{
+    testSmallIntegralCoefficient();
+    testClosedLoop();
+    testIrregularPeriod();
+    return hostTestResult();
+}
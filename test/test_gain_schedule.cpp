@@ -0,0 +1,103 @@
+// Host test of GainSchedule interpolation, and that a schedule cannot be built on a temporary table
+// Gain changes through PIDcontrol::setGains() / scheduleGains() have to be bumpless: with error and
+// derivative held constant the output keeps changing by the integral step only, in both forms, and a
+// schedule switch at steady state of a closed loop leaves output and speed in place
+
+#include "HostTest.h"
+#include "GainSchedule.h"
+#include "MotorPlant.h"
+#include "PIDcontrol.h"
+#include <type_traits>
+
+namespace {
+    using Table = std::array<GainPoint, 3>;
+
+    // points are not copied, only storage that outlives the schedule is accepted
+    static_assert(std::is_constructible<GainSchedule, const Table&>::value, "lvalue table");
+    static_assert(!std::is_constructible<GainSchedule, Table&&>::value, "temporary table would dangle");
+    static_assert(!std::is_convertible<Table&&, GainSchedule>::value, "temporary table would dangle");
+
+    static constexpr Table gainTable {{
+            {10.0f, 0.30f, 3.0f, 0.05f},
+            {50.0f, 0.20f, 2.0f, 0.08f},
+            {90.0f, 0.15f, 1.5f, 0.10f}}};
+
+    void testLookup()
+    {
+        constexpr GainSchedule schedule(gainTable);
+        CHECK(!schedule.empty());
+        CHECK(GainSchedule().empty());
+        GainPoint below = schedule.lookup(0.0f);
+        CHECK(below.Kp == 0.30f && below.Ki == 3.0f);
+        GainPoint above = schedule.lookup(100.0f);
+        CHECK(above.Kp == 0.15f && above.Kd == 0.10f);
+        GainPoint middle = schedule.lookup(30.0f);
+        CHECK_NEAR(middle.Kp, 0.25f, 1e-6f);
+        CHECK_NEAR(middle.Ki, 2.5f, 1e-6f);
+        CHECK_NEAR(middle.Kd, 0.065f, 1e-6f);
+        GainPoint point = schedule.lookup(50.0f);
+        CHECK_NEAR(point.Kp, 0.20f, 1e-6f);
+    }
+
+    void testBumplessGains(PIDcontrol::Form form)
+    {
+        // constant error, measurement ramping so that filtered derivative is non-zero
+        const float error = 2.0f, dt = 0.001f;
+        PIDcontrol pid(0.30f, 3.0f, 0.05f, 5.0f);
+        pid.setForm(form);
+        float output = 0.0f, previous = 0.0f;
+        int k = 0;
+        for (; k < 2000; k++) {
+            previous = output;
+            output = pid.compensateSignal(error, 20.0f + 10.0f * k * dt, (unsigned long long)(dt * 1e6f));
+        }
+        float before = output - previous;
+        CHECK_NEAR(before, 3.0f * error * dt, 1e-4f);
+
+        // P changes by 0.15 * error = 0.3, D by 0.05 * 10 = 0.5 if not taken up by the integral
+        pid.setGains(0.15f, 1.5f, 0.10f);
+        previous = output;
+        output = pid.compensateSignal(error, 20.0f + 10.0f * k * dt, (unsigned long long)(dt * 1e6f));
+        std::printf("%s: output step %.5f before, %.5f at gain change\n",
+                    form == PIDcontrol::Form::Positional ? "Positional" : "Velocity", before, output - previous);
+        CHECK_NEAR(output - previous, 1.5f * error * dt, 1e-4f);
+    }
+
+    void testScheduleAtSteadyState()
+    {
+        const uint32_t period_us = 10000;
+        constexpr GainSchedule schedule(gainTable);
+        MotorPlant plant(1.0f, 0.2f, 0.02f, 10.0f);
+        PIDcontrol pid(0.0f, 0.0f, 0.0f);
+        pid.setOutputLimits(0.0f, 100.0f);
+        pid.setGainSchedule(schedule);
+        float speed = 0.0f, output = 0.0f;
+        for (int i = 0; i < 500; i++) {
+            pid.scheduleGains(10.0f);
+            output = pid.compensateSignal(50.0f - speed, speed, period_us);
+            speed = plant.step(output, period_us * 1e-6f);
+        }
+        // gains of reference 90 taken over in one step
+        float settledOutput = output, settledSpeed = speed, worst = 0.0f;
+        for (int i = 0; i < 100; i++) {
+            pid.scheduleGains(90.0f);
+            output = pid.compensateSignal(50.0f - speed, speed, period_us);
+            speed = plant.step(output, period_us * 1e-6f);
+            worst = std::fmax(worst, std::fabs(output - settledOutput));
+        }
+        std::printf("schedule switch at steady state: output moved %.4f, speed %.4f\n", worst,
+                    std::fabs(speed - settledSpeed));
+        CHECK(pid.getKp() == 0.15f);
+        CHECK(worst < 0.05f);
+        CHECK_NEAR(speed, settledSpeed, 0.05f);
+    }
+}
+
+int main()
+{
+    testLookup();
+    testBumplessGains(PIDcontrol::Form::Positional);
+    testBumplessGains(PIDcontrol::Form::Velocity);
+    testScheduleAtSteadyState();
+    return hostTestResult();
+}
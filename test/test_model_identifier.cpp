@@ -0,0 +1,80 @@
+// Host test of ModelIdentifier on a simulated DC motor (FOPDT plant with deadband)
+// Duty steps between levels above deadband at 100 Hz control rate, the RLS estimate has to recover
+// gain, time constant, delay and deadband of the plant. MotorPlant integrates by backward Euler in 1 ms
+// substeps, which lengthens the time constant seen at sample rate by about half a substep
+
+#include "HostTest.h"
+#include "ModelIdentifier.h"
+#include "MotorPlant.h"
+
+namespace {
+    const uint32_t period_us = 10000;
+
+    /** Duty held for 5 to 29 periods at pseudo random levels between 35 and 85 */
+    struct Excitation {
+        float next() {
+            if (hold == 0) {
+                seed = seed * 1103515245u + 12345u;
+                duty = 35.0f + (float)((seed >> 16) % 51);
+                hold = 5 + (seed >> 8) % 25;
+            }
+            hold--;
+            return duty;
+        }
+        unsigned int seed = 12345, hold = 0;
+        float duty = 0.0f;
+    };
+
+    ModelIdentifier::Model identify(float gain, float timeConstant, float delay, float deadband, int samples)
+    {
+        MotorPlant plant(gain, timeConstant, delay, deadband);
+        ModelIdentifier identifier(0.995f);
+        Excitation excitation;
+        for (int k = 0; k < samples; k++) {
+            float duty = excitation.next();
+            float speed = plant.step(duty, period_us * 1e-6f);
+            identifier.update(duty, speed, period_us);
+        }
+        return identifier.getModel();
+    }
+
+    void testRecover(float gain, float timeConstant, float delay, float deadband)
+    {
+        ModelIdentifier::Model model = identify(gain, timeConstant, delay, deadband, 3000);
+        std::printf("plant K %.2f T %.3f L %.3f D %.1f -> model K %.3f T %.4f L %.3f D %.2f (%s)\n",
+                    gain, timeConstant, delay, deadband, model.gain, model.timeConstant, model.delay,
+                    model.deadband, model.valid ? "valid" : "invalid");
+        CHECK(model.valid);
+        CHECK_NEAR(model.gain, gain, 0.02f * gain);
+        CHECK_NEAR(model.timeConstant, timeConstant + 0.0005f, 0.02f * timeConstant);
+        CHECK_NEAR(model.delay, delay, 1e-4f);
+        CHECK_NEAR(model.deadband, deadband, 0.5f);
+    }
+}
+
+int main()
+{
+    testRecover(1.2f, 0.3f, 0.02f, 15.0f);
+    testRecover(0.8f, 0.1f, 0.0f, 5.0f);
+    testRecover(1.0f, 0.5f, 0.04f, 25.0f);
+
+    // too few samples to tell
+    CHECK(!identify(1.2f, 0.3f, 0.02f, 15.0f, 10).valid);
+
+    // hold() while stopped keeps the estimate, history restarts after it
+    {
+        MotorPlant plant(1.2f, 0.3f, 0.02f, 15.0f);
+        ModelIdentifier identifier;
+        Excitation excitation;
+        for (int k = 0; k < 3000; k++) {
+            float duty = excitation.next();
+            if (k == 1500) identifier.hold();
+            identifier.update(duty, plant.step(duty, period_us * 1e-6f), period_us);
+        }
+        ModelIdentifier::Model model = identifier.getModel();
+        CHECK(model.valid);
+        CHECK_NEAR(model.gain, 1.2f, 0.024f);
+        CHECK_NEAR(model.delay, 0.02f, 1e-4f);
+    }
+    return hostTestResult();
+}
@@ -0,0 +1,110 @@
+// Host test of MovingAverage against a naive re-sum of the window at every sample, over millions of samples
+// int T sums in a 64-bit accumulator and has to match exactly (window sum exceeds 32-bit here),
+// float T re-sums its buffer once per N samples and has to stay within rounding of one re-sum, while a
+// running float sum that is never re-summed drifts with the number of samples
+// getDataList() has to return the window in chronological order, also while the buffer is filling
+
+#include <deque>
+#include "HostTest.h"
+#include "MovingAverage.h"
+
+namespace {
+    const long samples = 4000000;
+
+    /** Last N data and their sum evaluated from scratch, T sum for int, double for float */
+    template<typename T, int N>
+    class NaiveWindow {
+    public:
+        void AddData(T data) {
+            if ((int)_dataList.size() == N) _dataList.pop_front();
+            _dataList.push_back(data);
+        }
+        double getValue() const {
+            if (std::is_integral<T>::value) {
+                int64_t sum = 0;
+                for (auto val : _dataList) sum += val;
+                return (double)(T)(sum / (int64_t)_dataList.size());
+            }
+            double sum = 0;
+            for (auto val : _dataList) sum += val;
+            return sum / _dataList.size();
+        }
+        bool sameData(const MovingAverage<T, N>& average) const {
+            if (average.size() != (int)_dataList.size()) return false;
+            auto dataList = average.getDataList();
+            for (std::size_t i = 0; i < _dataList.size(); i++) {
+                if (dataList[i] != _dataList[i]) return false;
+            }
+            return true;
+        }
+    private:
+        std::deque<T> _dataList;
+    };
+
+    /** Worst difference of getValue() to the naive window, and whether getDataList() always matched */
+    template<typename T, int N, typename Data>
+    double worstError(Data data, bool& sameData)
+    {
+        MovingAverage<T, N> average;
+        NaiveWindow<T, N> naive;
+        double worst = 0;
+        sameData = true;
+        for (long i = 0; i < samples; i++) {
+            average.AddData(data(i));
+            naive.AddData(data(i));
+            worst = std::fmax(worst, std::fabs(average.getValue() - naive.getValue()));
+            if (i < 4 * N || i % 1000 == 0) sameData = sameData && naive.sameData(average);
+        }
+        return worst;
+    }
+
+    /** Drift of a running float sum that is never re-summed, for comparison */
+    template<int N, typename Data>
+    double runningSumDrift(Data data)
+    {
+        std::deque<float> window;
+        float sum = 0;
+        for (long i = 0; i < samples; i++) {
+            if ((int)window.size() == N) { sum -= window.front(); window.pop_front(); }
+            window.push_back(data(i));
+            sum += data(i);
+        }
+        double exact = 0;
+        for (auto val : window) exact += val;
+        return std::fabs(sum / N - exact / N);
+    }
+}
+
+int main()
+{
+    // int: large samples, 21 of them overflow a 32-bit sum
+    {
+        auto data = [](long i) { return (int)((i * 7919) % 400000001) - 200000000; };
+        bool sameData;
+        double worst = worstError<int, 21>(data, sameData);
+        std::printf("int, N = 21: largest difference %g over %ld samples\n", worst, samples);
+        CHECK(worst == 0);
+        CHECK(sameData);
+    }
+    // float: offset plus small varying part, where rounding of a running sum accumulates
+    for (int pass = 0; pass < 2; pass++) {
+        auto data = [](long i) { return 1000.0f + (float)((i * 7919) % 1000) * 0.0137f; };
+        bool sameData;
+        double worst = pass == 0 ? worstError<float, 21>(data, sameData) : worstError<float, 11>(data, sameData);
+        double drift = pass == 0 ? runningSumDrift<21>(data) : runningSumDrift<11>(data);
+        std::printf("float, N = %d: largest difference %g over %ld samples, never re-summed running sum %g\n",
+                    pass == 0 ? 21 : 11, worst, samples, drift);
+        // bounded by rounding of the N additions since the last re-sum (ulp of the sum is 2e-3), not by samples
+        CHECK(worst < 1e-3);
+        CHECK(sameData);
+    }
+    // filling buffer: average of the data so far
+    {
+        MovingAverage<float, 5> average(2.0f);
+        average.AddData(4.0f);
+        CHECK(average.size() == 2);
+        CHECK_NEAR(average.getValue(), 3.0f, 1e-6f);
+        CHECK(average.getDataList()[0] == 2.0f && average.getDataList()[1] == 4.0f);
+    }
+    return hostTestResult();
+}
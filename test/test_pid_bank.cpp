@@ -0,0 +1,81 @@
+// Host comparison of PIDBank with separate PIDcontrol objects (Positional, BackCalculation)
+// Loops with different gains, cutoffs and limits drive motor plants side by side, restarted midway;
+// bank output has to follow PIDcontrol within float rounding, including the first step after start and reset
+// where there is no previous measurement and the derivative must not see measurement / dt
+
+#include <array>
+#include "HostTest.h"
+#include "MotorPlant.h"
+#include "PIDBank.h"
+#include "PIDcontrol.h"
+
+namespace {
+    const std::size_t loops = 4;
+    const uint32_t period_us = 10000;
+
+    struct Gains {
+        float Kp, Ki, Kd, cutoff, minOutput, maxOutput;
+    };
+    const std::array<Gains, loops> gains = {{
+            {0.2f, 2.0f, 0.08f, 0.2f, 0.0f, 100.0f},
+            {0.5f, 1.0f, 0.02f, 5.0f, 0.0f, 100.0f},
+            {1.0f, 4.0f, 0.0f, 0.0f, -50.0f, 50.0f},
+            {0.1f, 0.5f, 0.2f, 2.0f, 0.0f, 30.0f},     // saturates, back calculation active
+    }};
+}
+
+int main()
+{
+    // measurement held away from 0 at zero error: output has to stay at 0 from the first step
+    {
+        PIDBank<1> bank;
+        bank.setGains(0, 0.2f, 2.0f, 0.08f, 5.0f);
+        float worst = 0.0f;
+        for (int i = 0; i < 100; i++) {
+            float output = bank.step({0.0f}, {50.0f}, period_us)[0];
+            worst = std::fmax(worst, std::fabs(output));
+        }
+        std::printf("zero error, measurement 50: largest output %g\n", worst);
+        CHECK_NEAR(worst, 0.0f, 1e-6f);
+    }
+
+    PIDBank<loops> bank;
+    std::array<PIDcontrol, loops> pids = {{
+            PIDcontrol(gains[0].Kp, gains[0].Ki, gains[0].Kd, gains[0].cutoff),
+            PIDcontrol(gains[1].Kp, gains[1].Ki, gains[1].Kd, gains[1].cutoff),
+            PIDcontrol(gains[2].Kp, gains[2].Ki, gains[2].Kd, gains[2].cutoff),
+            PIDcontrol(gains[3].Kp, gains[3].Ki, gains[3].Kd, gains[3].cutoff),
+    }};
+    std::array<MotorPlant, loops> plants = {{
+            MotorPlant(1.0f, 0.3f, 0.02f, 10.0f), MotorPlant(0.8f, 0.1f),
+            MotorPlant(1.2f, 0.5f, 0.05f), MotorPlant(1.0f, 0.2f, 0.0f, 5.0f),
+    }};
+    for (std::size_t i = 0; i < loops; i++) {
+        bank.setGains(i, gains[i].Kp, gains[i].Ki, gains[i].Kd, gains[i].cutoff);
+        bank.setOutputLimits(i, gains[i].minOutput, gains[i].maxOutput);
+        pids[i].setOutputLimits(gains[i].minOutput, gains[i].maxOutput);
+    }
+
+    PIDBank<loops>::Signals error{}, measurement{};
+    float worst = 0.0f;
+    for (int k = 0; k < 600; k++) {
+        if (k == 300) {
+            // restart from current output, measurement keeps its value
+            for (std::size_t i = 0; i < loops; i++) {
+                bank.reset(i, bank.getOutput()[i], measurement[i]);
+                pids[i].reset(pids[i].getOutput());
+            }
+        }
+        float reference = k < 150 ? 40.0f : 70.0f;
+        for (std::size_t i = 0; i < loops; i++) error[i] = reference - measurement[i];
+        const auto& output = bank.step(error, measurement, period_us);
+        for (std::size_t i = 0; i < loops; i++) {
+            float expected = pids[i].compensateSignal(error[i], measurement[i], period_us);
+            worst = std::fmax(worst, std::fabs(output[i] - expected));
+            measurement[i] = plants[i].step(output[i], period_us * 1e-6f);
+        }
+    }
+    std::printf("largest difference to PIDcontrol over %zu loops: %g\n", loops, worst);
+    CHECK(worst < 1e-3f);
+    return hostTestResult();
+}
@@ -0,0 +1,60 @@
+// Host simulation of PIDcontrol forms on a saturating motor plant
+// Start from standstill to 80 % of rated speed, output limited to 0 - 100 duty, motor needs 90 % duty
+// Without anti-windup the integrator winds up during the saturated start and overshoots,
+// back-calculation, conditional integration and velocity form settle faster
+
+#include "HostTest.h"
+#include "MotorPlant.h"
+#include "PIDcontrol.h"
+
+namespace {
+    struct Response {
+        float settlingTime;     // last time outside +/- 2 of reference (s)
+        float overshoot;        // peak above reference
+    };
+
+    Response simulate(PIDcontrol::Form form, PIDcontrol::AntiWindup antiWindup)
+    {
+        const float reference = 80.0f;
+        const float dt = 0.01f;             // 100 Hz control
+        const float duration = 10.0f;
+        MotorPlant plant(1.0f, 1.0f, 0.05f, 10.0f);
+        PIDcontrol pid(0.2f, 2.0f, 0.08f);
+        pid.setForm(form);
+        pid.setAntiWindup(antiWindup);
+        pid.setOutputLimits(0.0f, 100.0f);
+
+        Response response{0.0f, 0.0f};
+        float speed = 0.0f;
+        for (int i = 0; i * dt < duration; i++) {
+            float output = pid.compensateSignal(reference - speed, speed, (unsigned long long)(dt * 1e6f));
+            CHECK(output >= 0.0f && output <= 100.0f);
+            speed = plant.step(output, dt);
+            if (speed - reference > response.overshoot) response.overshoot = speed - reference;
+            if (std::fabs(speed - reference) > 2.0f) response.settlingTime = (i + 1) * dt;
+        }
+        return response;
+    }
+}
+
+int main()
+{
+    Response none = simulate(PIDcontrol::Form::Positional, PIDcontrol::AntiWindup::None);
+    Response conditional = simulate(PIDcontrol::Form::Positional, PIDcontrol::AntiWindup::Conditional);
+    Response backCalculation = simulate(PIDcontrol::Form::Positional, PIDcontrol::AntiWindup::BackCalculation);
+    Response velocity = simulate(PIDcontrol::Form::Velocity, PIDcontrol::AntiWindup::None);
+    std::printf("positional, no anti-windup:  settle %.2f s, overshoot %.2f\n", none.settlingTime, none.overshoot);
+    std::printf("positional, conditional:     settle %.2f s, overshoot %.2f\n",
+                conditional.settlingTime, conditional.overshoot);
+    std::printf("positional, back-calculation: settle %.2f s, overshoot %.2f\n",
+                backCalculation.settlingTime, backCalculation.overshoot);
+    std::printf("velocity:                    settle %.2f s, overshoot %.2f\n",
+                velocity.settlingTime, velocity.overshoot);
+
+    for (const Response& response : {conditional, backCalculation, velocity}) {
+        CHECK(response.settlingTime < none.settlingTime);
+        CHECK(response.overshoot < none.overshoot);
+        CHECK(response.settlingTime < 10.0f);      // settled within simulated time
+    }
+    return hostTestResult();
+}
@@ -0,0 +1,175 @@
+// Host test of quadrature decoding (ISR backend, through FakePulseCounter) and of the
+// 16-bit count unwrapping of the TIM1 backend
+
+#include "HostTest.h"
+#include "FakePulseCounter.h"
+#include "QuadratureDecoder.h"
+
+namespace {
+    void testForwardReverse()
+    {
+        FakePulseCounter counter(EncodeType::X4);
+        counter.start();
+        counter.rotate(8);
+        CHECK(counter.peekPulses() == 8);
+        CHECK(counter.takePulses() == 8);
+        CHECK(counter.takePulses() == 0);      // count restarts
+        counter.rotate(-12);
+        CHECK(counter.takePulses() == -12);
+        CHECK(counter.getInvalidTransitions() == 0);
+
+        // X1 counts rising edge of A, X2 both edges of A, one A rising edge per 4 X4 edges
+        FakePulseCounter x1(EncodeType::X1), x2(EncodeType::X2);
+        x1.start();
+        x2.start();
+        x1.rotate(16);
+        x2.rotate(16);
+        CHECK(x1.takePulses() == 4);
+        CHECK(x2.takePulses() == 8);
+        x1.rotate(-16);
+        x2.rotate(-16);
+        CHECK(x1.takePulses() == -4);
+        CHECK(x2.takePulses() == -8);
+
+        // stopped counter ignores edges
+        counter.stop();
+        counter.rotate(4);
+        CHECK(counter.takePulses() == 0);
+    }
+
+    void testInvalidTransition()
+    {
+        FakePulseCounter counter(EncodeType::X4);
+        counter.start();
+        counter.setState(0x3);                  // 00 -> 11, both lines changed at once
+        CHECK(counter.getInvalidTransitions() == 1);
+        CHECK(counter.takePulses() == 0);
+        counter.setState(0x0);                  // 11 -> 00
+        CHECK(counter.getInvalidTransitions() == 2);
+        counter.start();
+        CHECK(counter.getInvalidTransitions() == 0);
+    }
+
+    void testEdgeTime()
+    {
+        FakePulseCounter counter(EncodeType::X4);
+        counter.start();
+        CHECK(counter.getEdgeTime().direction == 0);
+        counter.rotate(5, 1000, 250);
+        PulseCounter::EdgeTime edge = counter.getEdgeTime();
+        CHECK(edge.lastEdge == 2000);
+        CHECK(edge.edgePeriod == 250);
+        CHECK(edge.direction == 1);
+        // period across direction change is not a rotation period
+        counter.rotate(-1, 2100);
+        edge = counter.getEdgeTime();
+        CHECK(edge.direction == -1);
+        CHECK(edge.edgePeriod == 0);
+
+        FakePulseCounter untimed(EncodeType::X4, false);
+        CHECK(!untimed.hasEdgeTime());
+    }
+
+    int compareCalls = 0;
+    void onCompare(void*) { compareCalls++; }
+
+    void testCompare()
+    {
+        FakePulseCounter counter(EncodeType::X4);
+        counter.start();
+        counter.armCompare(5, 1, &onCompare, nullptr);
+        counter.rotate(4);
+        CHECK(compareCalls == 0);
+        counter.rotate(1);
+        CHECK(compareCalls == 1);
+        counter.rotate(10);
+        CHECK(compareCalls == 1);               // disarmed at the edge it fired
+        counter.armCompare(-3, -1, &onCompare, nullptr);
+        counter.rotate(-17);
+        CHECK(compareCalls == 1);
+        counter.rotate(-1);
+        CHECK(compareCalls == 2);
+        counter.armCompare(0, 1, &onCompare, nullptr);
+        counter.disarmCompare();
+        counter.rotate(10);
+        CHECK(compareCalls == 2);
+    }
+
+    void testCounterWraparound()
+    {
+        CounterUnwrapper count(EncodeType::X4, false);
+        count.start(65530);
+        CHECK(count.peekPulses(5) == 11);
+        CHECK(count.takePulses(5) == 11);      // wrapped forward through 0
+        CHECK(count.takePulses(65533) == -8);  // wrapped backward through 0
+        CHECK(count.takePulses((uint16_t)(65533u + 32767u)) == 32767);
+
+        CounterUnwrapper inverted(EncodeType::X4, true);
+        inverted.start(10);
+        CHECK(inverted.takePulses(65535) == 11);
+
+        // long run, positions summed from 16-bit snapshots match the true count
+        CounterUnwrapper run(EncodeType::X4, false);
+        run.start(0);
+        long long position = 0, sum = 0;
+        for (int i = 0; i < 1000; i++) {
+            position += (i % 7 - 3) * 4001;
+            sum += run.takePulses((uint16_t)position);
+        }
+        CHECK(sum == position);
+    }
+
+    void testEdgeSequence()
+    {
+        // two steps per counted edge, even outside count(), also seen from the compare handler
+        FakePulseCounter counter(EncodeType::X4, true);
+        counter.start();
+        uint32_t begin = counter.getEdgeSequence();
+        counter.rotate(5);
+        CHECK(counter.getEdgeSequence() == begin + 10);
+        CHECK((counter.getEdgeSequence() & 1u) == 0);
+
+        static uint32_t seenInHandler;
+        seenInHandler = 1;
+        counter.armCompare(7, 1, [](void* context) {
+            seenInHandler = static_cast<FakePulseCounter*>(context)->getEdgeSequence();
+        }, &counter);
+        counter.rotate(2);
+        CHECK((seenInHandler & 1u) == 0);
+    }
+
+    void testX1Residual()
+    {
+        // X1 hardware counts both edges of A, odd count is carried to next period
+        CounterUnwrapper count(EncodeType::X1, false);
+        count.start(0);
+        CHECK(count.peekPulses(3) == 1);
+        CHECK(count.takePulses(3) == 1);
+        CHECK(count.peekPulses(6) == 2);       // 3 + carried 1
+        CHECK(count.takePulses(6) == 2);
+        CHECK(count.takePulses(3) == -1);      // -3, carry -1
+        CHECK(count.takePulses(2) == -1);      // -1 + carried -1
+
+        // odd counts every period never lose a pulse
+        count.start(65534);
+        long sum = 0;
+        uint16_t hardware = 65534;
+        for (int i = 0; i < 100; i++) {
+            hardware = (uint16_t)(hardware + 3);
+            sum += count.takePulses(hardware);
+        }
+        CHECK(sum == 150);
+    }
+}
+
+int main()
+{
+    testForwardReverse();
+    testInvalidTransition();
+    testEdgeTime();
+    testCompare();
+    testCounterWraparound();
+    testEdgeSequence();
+    testX1Residual();
+    return hostTestResult();
+}
@@ -0,0 +1,145 @@
+// Host model of motor PWM: winding current and shaft speed ripple against frequency, and duty resolution of
+// PwmOut (1 us ticks) against TIM2 counting at 100 MHz (TimerPwmOut)
+// Winding is R-L with constant back EMF, current is integrated piecewise exactly and checked against the
+// closed form ripple dI = V/R * (1 - a^D) * (1 - a^(1-D)) / (1 - a), a = exp(-T/tau)
+// Speed ripple: the same winding drives the rotor, torque kt * i against inertia and viscous friction, back EMF
+// ke * w, from the mbed default 50 Hz up to 20 kHz
+// Speed loop runs with duty rounded to either resolution, coarse steps leave a limit cycle in speed
+
+#include "HostTest.h"
+#include "MotorPlant.h"
+#include "PIDcontrol.h"
+
+namespace {
+    const float supply = 12.0f;         // V
+    const float resistance = 4.0f;      // ohm
+    const float inductance = 2e-3f;     // H, tau = 0.5 ms
+    const float timerClock = 100e6f;    // TIM2 on NUCLEO_F411RE (Hz)
+    const float motorConstant = 0.02f;  // V s/rad and N m/A
+    const float inertia = 2e-6f;        // kg m^2
+    const float friction = 1e-4f;       // N m s/rad, load, mechanical time constant J / (b + k^2 / R) = 10 ms
+
+    /** Peak to peak current at periodic steady state, back EMF in V */
+    float simulateRipple(float frequency, float duty, float backEmf)
+    {
+        double tau = inductance / resistance;
+        double period = 1.0 / frequency;
+        double current = 0.0, low = 0.0, high = 0.0;
+        for (int cycle = 0; cycle < 200; cycle++) {
+            // on: current rises toward (V - E) / R, off: freewheels toward -E / R, clamped at 0
+            current = (supply - backEmf) / resistance
+                      + (current - (supply - backEmf) / resistance) * std::exp(-duty * period / tau);
+            high = current;
+            current = -backEmf / resistance + (current + backEmf / resistance) * std::exp(-(1 - duty) * period / tau);
+            if (current < 0) current = 0;
+            low = current;
+        }
+        return (float)(high - low);
+    }
+
+    float closedFormRipple(float frequency, float duty)
+    {
+        double a = std::exp(-1.0 / frequency * resistance / inductance);
+        return (float)(supply / resistance * (1 - std::pow(a, duty)) * (1 - std::pow(a, 1 - duty)) / (1 - a));
+    }
+
+    struct SpeedRipple {
+        float mean;                     // rad/s
+        float peakToPeak;
+    };
+
+    /** Speed of the rotor at periodic steady state, over the last 5 PWM periods after at least 10 mechanical
+     * time constants. Current is stepped exactly over substeps of 1/400 period with speed held,
+     * freewheels to 0 through the diode at low frequency
+     */
+    SpeedRipple simulateSpeedRipple(float frequency, float duty)
+    {
+        const int substeps = 400;
+        const double period = 1.0 / frequency, h = period / substeps;
+        const double decay = std::exp(-h * resistance / inductance);
+        int periods = (int)std::ceil(0.2 / period);
+        if (periods < 20) periods = 20;
+        double current = 0.0, speed = 0.0, sum = 0.0, low = 1e30, high = -1e30;
+        int samples = 0;
+        for (int p = 0; p < periods; p++) {
+            for (int k = 0; k < substeps; k++) {
+                double voltage = k < duty * substeps ? supply : 0.0;
+                double settled = (voltage - motorConstant * speed) / resistance;
+                current = settled + (current - settled) * decay;
+                if (current < 0) current = 0;
+                speed += h * (motorConstant * current - friction * speed) / inertia;
+                if (p >= periods - 5) {
+                    sum += speed;
+                    samples++;
+                    if (speed < low) low = speed;
+                    if (speed > high) high = speed;
+                }
+            }
+        }
+        return {(float)(sum / samples), (float)(high - low)};
+    }
+
+    /** Peak to peak speed over last 2 s of a 6 s run at reference, duty rounded to steps per period */
+    float speedLimitCycle(unsigned int steps, float reference)
+    {
+        const float dt = 0.01f;
+        MotorPlant plant(1.0f, 0.2f, 0.02f, 10.0f);
+        PIDcontrol pid(0.2f, 2.0f, 0.0f);
+        pid.setOutputLimits(0.0f, 100.0f);
+        float speed = 0.0f, low = 1e9f, high = -1e9f;
+        for (int i = 0; i * dt < 6.0f; i++) {
+            float output = pid.compensateSignal(reference - speed, speed, (unsigned long long)(dt * 1e6f));
+            float duty = std::floor(output / 100 * steps + 0.5f) * 100 / steps;
+            speed = plant.step(duty, dt);
+            if (i * dt >= 4.0f) {
+                if (speed < low) low = speed;
+                if (speed > high) high = speed;
+            }
+        }
+        return high - low;
+    }
+}
+
+int main()
+{
+    std::printf("frequency  ripple(A)  PwmOut steps  TIM2 steps\n");
+    float previous = 1e9f;
+    for (float frequency : {1000.0f, 5000.0f, 10000.0f, 20000.0f}) {
+        float ripple = simulateRipple(frequency, 0.5f, 0.0f);
+        auto pwmOutSteps = (unsigned int)(1e6f / frequency + 0.5f);
+        auto timerSteps = (unsigned int)(timerClock / frequency + 0.5f);
+        std::printf("%6.0f Hz  %9.4f  %12u  %10u\n", frequency, ripple, pwmOutSteps, timerSteps);
+        CHECK_NEAR(ripple, closedFormRipple(frequency, 0.5f), 0.01f * ripple);
+        CHECK(ripple < previous);
+        previous = ripple;
+    }
+    // ripple falls about as 1 / f once period is short against tau
+    CHECK(simulateRipple(10000.0f, 0.5f, 0.0f) < 0.12f * simulateRipple(1000.0f, 0.5f, 0.0f));
+    // running motor: back EMF shifts mean current but not ripple while conduction is continuous,
+    // ripple is largest at 50 % duty
+    CHECK_NEAR(simulateRipple(10000.0f, 0.5f, 4.0f), simulateRipple(10000.0f, 0.5f, 0.0f), 1e-4f);
+    CHECK(simulateRipple(10000.0f, 0.1f, 0.0f) < simulateRipple(10000.0f, 0.5f, 0.0f));
+
+    // speed ripple falls with frequency, as 1 / f^2 once both winding and rotor filter the PWM. Mean speed is set
+    // by duty alone while conduction is continuous (1 kHz and up), at 50 Hz current stops in every period
+    std::printf("frequency  mean speed (rad/s)  speed ripple (rad/s)\n");
+    SpeedRipple reference = simulateSpeedRipple(20000.0f, 0.5f);
+    SpeedRipple previousSpeed = {0.0f, 1e30f};
+    for (float frequency : {50.0f, 1000.0f, 5000.0f, 10000.0f, 20000.0f}) {
+        SpeedRipple speed = simulateSpeedRipple(frequency, 0.5f);
+        std::printf("%6.0f Hz  %18.2f  %20.5f\n", frequency, speed.mean, speed.peakToPeak);
+        CHECK(speed.peakToPeak < previousSpeed.peakToPeak);
+        if (frequency >= 1000.0f) CHECK_NEAR(speed.mean, reference.mean, 0.01f * reference.mean);
+        previousSpeed = speed;
+    }
+    CHECK(simulateSpeedRipple(20000.0f, 0.5f).peakToPeak < 0.3f * simulateSpeedRipple(10000.0f, 0.5f).peakToPeak);
+    CHECK(simulateSpeedRipple(10000.0f, 0.5f).peakToPeak < 0.02f * simulateSpeedRipple(1000.0f, 0.5f).peakToPeak);
+    CHECK(simulateSpeedRipple(10000.0f, 0.5f).peakToPeak < 1e-3f * simulateSpeedRipple(50.0f, 0.5f).peakToPeak);
+
+    float coarse = speedLimitCycle(100, 33.37f);
+    float fine = speedLimitCycle(10000, 33.37f);
+    std::printf("speed limit cycle at 10 kHz: %.3f with 100 steps, %.4f with 10000 steps\n", coarse, fine);
+    CHECK(fine < coarse);
+    CHECK(fine < 0.05f);
+    return hostTestResult();
+}
@@ -0,0 +1,136 @@
+// Host test of relay auto-tune on a simulated DC motor (FOPDT plant)
+// For gain K, time constant T and delay L an ideal relay of amplitude d gives the limit cycle
+//   Tu = 2 T ln(2 e^(L/T) - 1),  a = K d (1 - e^(-L/T)),  Ku = 4 d / (pi a)
+// Tuner has to find Ku and Tu, tuning rules are then checked against their definition,
+// and the tuned controller has to settle the plant
+// Hand-over to PIDcontrol is run the way MotorControl::startAutoTune() / runAutoTune() run it: relay bias
+// clamped into output range, tuned gains replacing the gain schedule, PID resuming from the relay output
+
+#include <array>
+#include "HostTest.h"
+#include "MotorPlant.h"
+#include "RelayAutoTuner.h"
+#include "PIDcontrol.h"
+
+namespace {
+    const float gain = 1.0f, timeConstant = 0.5f, delay = 0.1f;
+    const float setpoint = 50.0f, amplitude = 20.0f;
+    const uint32_t period_us = 1000;        // 1 kHz control
+
+    constexpr std::array<GainPoint, 2> gainTable {{
+            {10.0f, 0.30f, 3.0f, 0.05f},
+            {90.0f, 0.15f, 1.5f, 0.10f}}};
+
+    RelayAutoTuner tune(RelayAutoTuner::TuningRule rule, MotorPlant& plant)
+    {
+        RelayAutoTuner tuner;
+        tuner.start(setpoint, setpoint / gain, amplitude, 0.0f, 4, rule);
+        float speed = plant.speed();
+        for (uint32_t time = 0; tuner.isRunning() && time < 30000000; time += period_us) {
+            speed = plant.step(tuner.update(speed, time), period_us * 1e-6f);
+        }
+        return tuner;
+    }
+
+    float settlingTime(const RelayAutoTuner::Gains& gains, MotorPlant& plant)
+    {
+        // step from tuning setpoint to 60, settled within +/- 1
+        PIDcontrol pid(gains.Kp, gains.Ki, gains.Kd);
+        pid.setOutputLimits(0.0f, 100.0f);
+        pid.reset(setpoint / gain);
+        float speed = plant.speed(), settled = 0.0f;
+        for (int i = 1; i <= 10000; i++) {
+            speed = plant.step(pid.compensateSignal(60.0f - speed, speed, period_us), period_us * 1e-6f);
+            if (std::fabs(speed - 60.0f) > 1.0f) settled = i * period_us * 1e-6f;
+        }
+        return settled;
+    }
+
+    void testRule(RelayAutoTuner::TuningRule rule, float kp, float ti, float td)
+    {
+        const float pi = 3.14159265f;
+        float ultimatePeriod = 2 * timeConstant * std::log(2 * std::exp(delay / timeConstant) - 1);
+        float oscillation = gain * amplitude * (1 - std::exp(-delay / timeConstant));
+        float ultimateGain = 4 * amplitude / (pi * oscillation);
+
+        MotorPlant plant(gain, timeConstant, delay);
+        RelayAutoTuner tuner = tune(rule, plant);
+        CHECK(tuner.isFinished());
+        CHECK_NEAR(tuner.getUltimatePeriod(), ultimatePeriod, 0.03f * ultimatePeriod);
+        CHECK_NEAR(tuner.getUltimateGain(), ultimateGain, 0.03f * ultimateGain);
+
+        // rule applied to the measured Ku and Tu
+        float Ku = tuner.getUltimateGain(), Tu = tuner.getUltimatePeriod();
+        RelayAutoTuner::Gains gains = tuner.getGains();
+        CHECK_NEAR(gains.Kp, kp * Ku, 1e-4f * Ku);
+        CHECK_NEAR(gains.Ki, kp * Ku / (ti * Tu), 1e-4f * Ku / Tu);
+        CHECK_NEAR(gains.Kd, kp * Ku * td * Tu, 1e-4f * Ku * Tu);
+
+        float settled = settlingTime(gains, plant);
+        std::printf("Ku %.3f (expected %.3f), Tu %.3f s (expected %.3f), Kp %.3f Ki %.3f Kd %.3f, settle %.2f s\n",
+                    Ku, ultimateGain, Tu, ultimatePeriod, gains.Kp, gains.Ki, gains.Kd, settled);
+        CHECK(settled < 5.0f);
+    }
+
+    void testTooWeakRelay()
+    {
+        // relay cannot lift the plant above setpoint, tuner fails on timeout instead of applying gains
+        MotorPlant plant(gain, timeConstant, delay);
+        RelayAutoTuner tuner;
+        tuner.setTimeout(2000000);
+        tuner.start(setpoint, 10.0f, 5.0f);
+        float speed = 0.0f;
+        for (uint32_t time = 0; tuner.isRunning() && time < 10000000; time += period_us)
+            speed = plant.step(tuner.update(speed, time), period_us * 1e-6f);
+        CHECK(tuner.getState() == RelayAutoTuner::State::Failed);
+    }
+
+    void testHandOver()
+    {
+        // setpoint below amplitude, relay would go negative around bias = setpoint
+        const float lowSetpoint = 10.0f, feedforward = 5.0f;
+        MotorPlant plant(gain, timeConstant, delay);
+        PIDcontrol pid(0.2f, 2.0f, 0.08f);
+        pid.setOutputLimits(-feedforward, 100.0f - feedforward);
+        pid.setGainSchedule(GainSchedule(gainTable));
+        RelayAutoTuner tuner;
+        tuner.startWithin(lowSetpoint, amplitude, 0.0f, 100.0f);
+
+        float speed = 0.0f, output = 0.0f, lowest = 1e9f, highest = -1e9f;
+        for (uint32_t time = 0; tuner.isRunning() && time < 30000000; time += period_us) {
+            output = tuner.update(speed, time, pid, feedforward);
+            if (tuner.isRunning()) {
+                lowest = std::fmin(lowest, output);
+                highest = std::fmax(highest, output);
+            }
+            speed = plant.step(output, period_us * 1e-6f);
+        }
+        CHECK(tuner.isFinished());
+        CHECK_NEAR(lowest, 0.0f, 1e-6f);
+        CHECK_NEAR(highest, 2 * amplitude, 1e-6f);
+
+        // tuned gains replace the schedule, scheduling at any reference keeps them
+        RelayAutoTuner::Gains gains = tuner.getGains();
+        pid.scheduleGains(90.0f);
+        CHECK(pid.getKp() == gains.Kp && pid.getKi() == gains.Ki && pid.getKd() == gains.Kd);
+
+        // first PID step continues from relay output, then holds the setpoint
+        float first = feedforward + pid.compensateSignal(lowSetpoint - speed, speed, period_us);
+        std::printf("hand-over: relay output %.3f, first PID output %.3f\n", output, first);
+        CHECK_NEAR(first, output, 0.05f * amplitude);
+        for (int i = 0; i < 5000; i++) {
+            speed = plant.step(feedforward + pid.compensateSignal(lowSetpoint - speed, speed, period_us),
+                               period_us * 1e-6f);
+        }
+        CHECK_NEAR(speed, lowSetpoint, 0.5f);
+    }
+}
+
+int main()
+{
+    testRule(RelayAutoTuner::TuningRule::ZieglerNichols, 0.6f, 0.5f, 0.125f);
+    testRule(RelayAutoTuner::TuningRule::TyreusLuyben, 1 / 2.2f, 2.2f, 1 / 6.3f);
+    testTooWeakRelay();
+    testHandOver();
+    return hostTestResult();
+}
@@ -0,0 +1,203 @@
+// Host simulation of StallDetector in the control loop of MotorControl
+// PIDcontrol follows a TrajectoryGenerator setpoint and drives a motor plant with deadband, encoder edges are
+// counted from simulated position. Duty goes through StallDetector::limit() with expectedSpeed() from the
+// calibrated curve, as in MotorControl::run()
+// Plant is jammed at full and at low reference, detector has to trip and limit() has to return 0 from the
+// control period the fault is detected until clear(), a motor too weak for its load trips Overload
+// Without a calibrated curve detection stays inactive, a motor with 40 % deadband started at 10 Hz must not trip
+
+#include "HostTest.h"
+#include "LookupTable.h"
+#include "MotorPlant.h"
+#include "PIDcontrol.h"
+#include "StallDetector.h"
+#include "TrajectoryGenerator.h"
+
+namespace {
+    const float edgesPerSecond = 1848 * 4 * 24 / 60.0f;    // at rated speed (100)
+    const uint32_t edgeTimeout_us = 300000;
+    const uint32_t overloadTime_us = 1000000;
+    using Curve = LookupTable<9>;
+
+    struct Scenario {
+        float gain = 1.0f;          // plant
+        float deadband = 10.0f;
+        float curveGain = 1.0f;     // gain seen at calibration
+        bool calibrated = true;
+        float minDuty = 15.0f;      // 5 above deadband, steady duty of reference 5
+        float reference = 50.0f;
+        float jamTime = -1.0f;      // s, negative for never
+        float clearTime = -1.0f;    // s, unjam and clear fault
+        float duration = 5.0f;
+        float dt = 0.01f;
+        float Kd = 0.0f;
+    };
+
+    struct Result {
+        StallDetector::Fault fault = StallDetector::Fault::None;
+        uint32_t tripTime = 0;      // us
+        float tripDuty = -1.0f;     // duty returned by limit() in the period the fault was detected
+        float latchedDuty = 0.0f;   // largest duty returned while latched
+        float finalSpeed = 0.0f;
+    };
+
+    /** Duty to speed curve of the unloaded motor, as DutyCalibrator measures it */
+    Curve calibratedCurve(const Scenario& scenario)
+    {
+        Curve curve;
+        if (!scenario.calibrated) return curve;
+        curve.setPoint(0, 0.0f, 0.0f);
+        curve.setPoint(1, scenario.deadband, 0.0f);
+        curve.setPoint(2, 100.0f, scenario.curveGain * (100.0f - scenario.deadband));
+        return curve;
+    }
+
+    Result simulate(const Scenario& scenario)
+    {
+        const auto period_us = (uint32_t)(scenario.dt * 1e6f + 0.5f);
+        MotorPlant plant(scenario.gain, 0.2f, 0.02f, scenario.deadband);
+        PIDcontrol pid(0.2f, 2.0f, scenario.Kd);
+        pid.setOutputLimits(0.0f, 100.0f);
+        TrajectoryGenerator profile(20.0f, 100.0f);
+        StallDetector detector;
+        detector.setThresholds(scenario.minDuty, 0.25f, overloadTime_us, edgeTimeout_us);
+        const Curve linearisation = calibratedCurve(scenario), feedforward;
+
+        Result result;
+        float speed = 0.0f;
+        double position = 0.0;              // encoder edges
+        long edges = 0;
+        uint32_t lastEdge = 0;
+        for (int i = 0; i * scenario.dt < scenario.duration; i++) {
+            uint32_t time = i * period_us;
+            float t = i * scenario.dt;
+            bool jammed = scenario.jamTime >= 0 && t >= scenario.jamTime;
+            plant.jam(jammed && (scenario.clearTime < 0 || t < scenario.clearTime));
+            if (scenario.clearTime >= 0 && i == (int)(scenario.clearTime / scenario.dt + 0.5f)) detector.clear();
+
+            bool faulted = detector.getFault() != StallDetector::Fault::None;
+            if (faulted) profile.reset(0.0f);
+            float setpoint = profile.update(faulted ? 0.0f : scenario.reference, scenario.dt);
+            float output = pid.compensateSignal(setpoint - speed, speed, period_us);
+            float duty = detector.limit(output, StallDetector::expectedSpeed(output, linearisation, feedforward),
+                                        speed, time, time - lastEdge);
+            if (!faulted && detector.getFault() != StallDetector::Fault::None) {
+                result.fault = detector.getFault();
+                result.tripTime = time;
+                result.tripDuty = duty;
+                pid.reset(0.0f);
+            }
+            else if (faulted) result.latchedDuty = std::fmax(result.latchedDuty, duty);
+
+            speed = plant.step(duty, scenario.dt);
+            position += speed / 100 * edgesPerSecond * scenario.dt;
+            if ((long)position != edges) {
+                edges = (long)position;
+                lastEdge = time + period_us;    // sampled at next control tick
+            }
+        }
+        result.finalSpeed = speed;
+        return result;
+    }
+
+    void checkJam(float reference)
+    {
+        Scenario scenario;
+        scenario.reference = reference;
+        scenario.jamTime = 3.0f;
+        const auto jam_us = (uint32_t)(scenario.jamTime * 1e6f);
+        const auto period_us = (uint32_t)(scenario.dt * 1e6f);
+        Result result = simulate(scenario);
+        std::printf("reference %5.1f: fault %d after %.3f s of jam\n", reference, (int)result.fault,
+                    (result.tripTime - jam_us) * 1e-6f);
+        CHECK(result.fault == StallDetector::Fault::Stall);
+        CHECK(result.tripTime >= jam_us + edgeTimeout_us - period_us);
+        CHECK(result.tripTime <= jam_us + edgeTimeout_us + period_us);    // within one control period of timeout
+        CHECK(result.tripDuty == 0.0f);
+        CHECK(result.latchedDuty == 0.0f);
+    }
+}
+
+int main()
+{
+    // no false trip from standstill to steady speed, low and high reference
+    for (float reference : {5.0f, 50.0f, 90.0f}) {
+        Scenario scenario;
+        scenario.reference = reference;
+        CHECK(simulate(scenario).fault == StallDetector::Fault::None);
+    }
+
+    // jam anywhere in the duty range, old check only ran at or above 80 % output
+    checkJam(90.0f);
+    checkJam(5.0f);
+
+    // at rest within deadband a jam is not a fault
+    {
+        Scenario scenario;
+        scenario.reference = 0.0f;
+        scenario.jamTime = 0.0f;
+        scenario.duration = 3.0f;
+        CHECK(simulate(scenario).fault == StallDetector::Fault::None);
+    }
+
+    // latched at 0 until clear(), then runs again once the jam is gone
+    {
+        Scenario scenario;
+        scenario.jamTime = 1.0f;
+        scenario.clearTime = 3.0f;
+        scenario.duration = 8.0f;
+        Result result = simulate(scenario);
+        CHECK(result.fault == StallDetector::Fault::Stall);
+        CHECK(result.latchedDuty == 0.0f);
+        CHECK_NEAR(result.finalSpeed, scenario.reference, 1.0f);
+    }
+
+    // motor turns at 15 % of calibrated speed, edges keep coming but speed cannot follow duty
+    {
+        Scenario scenario;
+        scenario.gain = 0.15f;
+        Result overload = simulate(scenario);
+        std::printf("overloaded: fault %d at %.3f s\n", (int)overload.fault, overload.tripTime * 1e-6f);
+        CHECK(overload.fault == StallDetector::Fault::Overload);
+        // speed falls behind the profile ramp (20 /s) early in the start
+        CHECK(overload.tripTime >= overloadTime_us);
+        CHECK(overload.tripTime <= overloadTime_us + (uint32_t)(scenario.reference / 20.0f * 1e6f));
+        CHECK(overload.tripDuty == 0.0f);
+        CHECK(overload.latchedDuty == 0.0f);
+    }
+
+    // 40 % deadband, full speed at full duty, PID with derivative at 10 Hz: every start passes through
+    // 20 - 40 % duty with the motor at rest
+    for (bool calibrated : {false, true}) {
+        for (float reference : {5.0f, 30.0f, 90.0f}) {
+            Scenario scenario;
+            scenario.gain = 100.0f / 60.0f;
+            scenario.deadband = 40.0f;
+            scenario.minDuty = 20.0f;           // MotorControl default
+            scenario.curveGain = scenario.gain;
+            scenario.calibrated = calibrated;
+            scenario.reference = reference;
+            scenario.dt = 0.1f;
+            scenario.Kd = 0.08f;
+            Result result = simulate(scenario);
+            std::printf("40 %% deadband, %s, reference %4.1f: fault %d, speed %.1f\n",
+                        calibrated ? "calibrated" : "no curve", reference, (int)result.fault, result.finalSpeed);
+            CHECK(result.fault == StallDetector::Fault::None);
+        }
+    }
+
+    // no curve, no detection: jam is not seen until the motor is calibrated
+    {
+        Curve empty;
+        CHECK(StallDetector::expectedSpeed(80.0f, empty, empty) == 0.0f);
+        StallDetector detector;
+        CHECK(detector.limit(80.0f, StallDetector::expectedSpeed(80.0f, empty, empty), 0.0f, 10000000, 10000000)
+              == 80.0f);
+    }
+
+    // disabled
+    StallDetector disabled;
+    disabled.setThresholds(0.0f, 0.25f, overloadTime_us, edgeTimeout_us);
+    CHECK(disabled.update(100.0f, 100.0f, 0.0f, 10000000, 10000000) == StallDetector::Fault::None);
+    return hostTestResult();
+}
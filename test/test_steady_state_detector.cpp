@@ -0,0 +1,91 @@
+// Host test of SteadyStateDetector against mean, variance and least squares slope evaluated from scratch
+// over the window at every sample, through many re-sums of the running sums, and of the steady decision
+// on settled, noisy, drifting and offset error signals
+
+#include <deque>
+#include "HostTest.h"
+#include "SteadyStateDetector.h"
+
+namespace {
+    struct Statistics {
+        double mean, variance, slope;
+    };
+
+    Statistics naive(const std::deque<float>& window)
+    {
+        double n = window.size(), mean = 0, variance = 0, slope = 0, indexMean = (n - 1) / 2, indexSquare = 0;
+        for (auto val : window) mean += val;
+        mean /= n;
+        for (std::size_t i = 0; i < window.size(); i++) {
+            variance += (window[i] - mean) * (window[i] - mean);
+            slope += (i - indexMean) * (window[i] - mean);
+            indexSquare += (i - indexMean) * (i - indexMean);
+        }
+        return {mean, variance / n, n > 1 ? slope / indexSquare : 0.0};
+    }
+
+    /** Decaying error with ripple and ramps, sign changes and quiet stretches */
+    float signal(long i)
+    {
+        return 8.0f * std::exp(-(float)(i % 500) / 80.0f) + 0.3f * std::sin(0.7f * i)
+               + ((i / 1000) % 2 ? 0.002f * (i % 1000) : -1.5f);
+    }
+
+    template<int N>
+    void testStatistics(long samples)
+    {
+        SteadyStateDetector<N> detector;
+        std::deque<float> window;
+        double worstMean = 0, worstVariance = 0, worstSlope = 0;
+        for (long i = 0; i < samples; i++) {
+            float sample = signal(i);
+            detector.addSample(sample);
+            if ((int)window.size() == N) window.pop_front();
+            window.push_back(sample);
+            Statistics expected = naive(window);
+            worstMean = std::fmax(worstMean, std::fabs(detector.getMean() - expected.mean));
+            worstVariance = std::fmax(worstVariance, std::fabs(detector.getVariance() - expected.variance));
+            worstSlope = std::fmax(worstSlope, std::fabs(detector.getSlope() - expected.slope));
+            if (i < N) CHECK(detector.size() == i + 1);
+        }
+        std::printf("N = %2d, %ld samples: largest difference mean %.2e, variance %.2e, slope %.2e\n",
+                    N, samples, worstMean, worstVariance, worstSlope);
+        // float running sums of values up to ~10, re-summed once per window
+        CHECK(worstMean < 1e-4);
+        CHECK(worstVariance < 1e-3);
+        CHECK(worstSlope < 1e-4);
+    }
+
+    template<int N>
+    bool steadyAfter(float (*error)(int), float tolerance)
+    {
+        SteadyStateDetector<N> detector(tolerance);
+        for (int i = 0; i < 10 * N; i++) detector.addSample(error(i));
+        return detector.isSteady();
+    }
+}
+
+int main()
+{
+    testStatistics<8>(1000000);
+    testStatistics<21>(1000000);
+
+    // tolerance 1: settled with small ripple is steady, offset, large ripple or drift are not
+    CHECK((steadyAfter<8>([](int i) { return 0.2f * std::sin(0.9f * i); }, 1.0f)));
+    CHECK((!steadyAfter<8>([](int i) { return 1.2f + 0.1f * std::sin(0.9f * i); }, 1.0f)));
+    CHECK((!steadyAfter<8>([](int i) { return 0.8f * std::sin(2.0f * i); }, 1.0f)));
+    // ramp through 0 over the last window: mean and spread are within tolerance, drift of 1.2 is not
+    CHECK((!steadyAfter<21>([](int i) { return 0.06f * (i - 199); }, 1.0f)));
+    CHECK((steadyAfter<21>([](int i) { return 0.01f * (i % 210) - 1.0f; }, 1.5f)));
+
+    // window has to be full, reset() empties it
+    {
+        SteadyStateDetector<8> detector(1.0f);
+        for (int i = 0; i < 7; i++) CHECK(!detector.addSample(0.0f));
+        CHECK(detector.addSample(0.0f));
+        detector.reset();
+        CHECK(!detector.isSteady() && detector.size() == 0);
+        CHECK(!detector.addSample(0.0f));
+    }
+    return hostTestResult();
+}
@@ -0,0 +1,94 @@
+// Host test of TrajectoryGenerator at the MotorControl defaults (20 /s, 100 /s^2) and control rates 1 kHz - 10 Hz
+// Setpoint rate stays within maxAcceleration and its change per step within maxJerk * dt, setpoint lands exactly
+// on target within the time of the ideal S-curve, and overshoot stays within one period of travel at the rate
+// limit (maxAcceleration * dt). At 10 Hz a step to 5 overshoots by 1.0 (20 %), at 100 Hz it does not
+
+#include <initializer_list>
+#include "HostTest.h"
+#include "TrajectoryGenerator.h"
+
+namespace {
+    const float maxAcceleration = 20.0f, maxJerk = 100.0f;
+
+    struct Run {
+        float overshoot = 0.0f;
+        float time = 0.0f;          // until settled
+        bool withinLimits = true;
+    };
+
+    /** Step from 0 to target, checking limits at every update */
+    Run step(float target, float dt, TrajectoryGenerator& profile)
+    {
+        Run run;
+        float previousSetpoint = profile.getSetpoint(), previousAcceleration = profile.getAcceleration();
+        float direction = target > previousSetpoint ? 1.0f : -1.0f;
+        for (int k = 1; k <= 100000; k++) {
+            float setpoint = profile.update(target, dt);
+            float acceleration = profile.getAcceleration();
+            run.withinLimits = run.withinLimits && std::fabs(acceleration) <= maxAcceleration * 1.0001f
+                               && std::fabs(acceleration - previousAcceleration) <= maxJerk * dt * 1.0001f
+                               && std::fabs(setpoint - previousSetpoint) <= maxAcceleration * dt * 1.0001f;
+            run.overshoot = std::fmax(run.overshoot, (setpoint - target) * direction);
+            previousSetpoint = setpoint;
+            previousAcceleration = acceleration;
+            if (profile.isSettled()) {
+                run.time = k * dt;
+                break;
+            }
+        }
+        return run;
+    }
+
+    /** Duration of the ideal S-curve from rest to rest over distance */
+    float idealTime(float distance)
+    {
+        distance = std::fabs(distance);
+        if (distance < maxAcceleration * maxAcceleration / maxJerk) return 2 * std::sqrt(distance / maxJerk);
+        return distance / maxAcceleration + maxAcceleration / maxJerk;
+    }
+}
+
+int main()
+{
+    for (float dt : {0.001f, 0.01f, 0.1f}) {
+        for (float target : {0.5f, 2.0f, 5.0f, 30.0f, 100.0f, -5.0f}) {
+            TrajectoryGenerator profile(maxAcceleration, maxJerk);
+            Run run = step(target, dt, profile);
+            std::printf("dt %.3f s, step to %6.1f: overshoot %.4f, settled in %.3f s (ideal %.3f s)\n",
+                        dt, target, run.overshoot, run.time, idealTime(target));
+            CHECK(run.withinLimits);
+            CHECK(profile.isSettled() && profile.getSetpoint() == target);
+            CHECK(run.time > 0 && run.time <= 1.25f * idealTime(target) + 2 * dt);
+            CHECK(run.overshoot <= maxAcceleration * dt);
+        }
+    }
+
+    // 10 Hz control rate: step to 5 overshoots by one jerk step over one period (maxJerk * dt^2)
+    {
+        TrajectoryGenerator profile(maxAcceleration, maxJerk);
+        CHECK_NEAR(step(5.0f, 0.1f, profile).overshoot, 1.0f, 1e-4f);
+        TrajectoryGenerator fast(maxAcceleration, maxJerk);
+        CHECK(step(5.0f, 0.01f, fast).overshoot < 1e-4f);
+    }
+
+    // target reversed while ramping up: limits hold through the reversal and setpoint lands on new target
+    {
+        TrajectoryGenerator profile(maxAcceleration, maxJerk);
+        for (int k = 0; k < 30; k++) profile.update(50.0f, 0.01f);
+        CHECK(profile.getAcceleration() > 0);
+        Run run = step(-10.0f, 0.01f, profile);
+        CHECK(run.withinLimits);
+        CHECK(profile.isSettled() && profile.getSetpoint() == -10.0f);
+    }
+
+    // no limits: setpoint follows target, reset() restarts at rest
+    {
+        TrajectoryGenerator profile;
+        CHECK(profile.update(42.0f, 0.01f) == 42.0f);
+        profile.setLimits(maxAcceleration, maxJerk);
+        profile.reset(10.0f);
+        CHECK(profile.isSettled() && profile.getSetpoint() == 10.0f);
+        CHECK_NEAR(profile.update(20.0f, 0.01f), 10.0f + maxJerk * 0.01f * 0.01f, 1e-5f);
+    }
+    return hostTestResult();
+}
@@ -0,0 +1,87 @@
+// Host test of TrapezoidalMove: end position, duration and limits of trapezoidal and triangular moves,
+// stepped at regular and irregular periods (profile is evaluated from elapsed time and must not drift)
+
+#include "HostTest.h"
+#include "TrapezoidalMove.h"
+
+namespace {
+    struct Run {
+        float peakSpeed = 0.0f;
+        float time = 0.0f;          // until finished
+        float midPosition = -1.0f;  // position at half the duration
+        bool withinLimits = true;   // speed and acceleration within limits, position never goes back
+    };
+
+    /** Step move to the end, period alternates between dt and 3 dt when irregular */
+    Run runMove(TrapezoidalMove& move, float speed, float acceleration, float dt, bool irregular)
+    {
+        Run run;
+        float previousPosition = 0.0f, previousSpeed = 0.0f;
+        for (int k = 0; move.isRunning() && !move.isFinished() && k < 1000000; k++) {
+            float step = irregular && (k % 2) ? 3 * dt : dt;
+            move.update(step);
+            run.time += step;
+            run.peakSpeed = std::fmax(run.peakSpeed, move.getSpeed());
+            run.withinLimits = run.withinLimits && move.getSpeed() <= speed * 1.0001f
+                               && std::fabs(move.getSpeed() - previousSpeed) <= acceleration * step * 1.0001f
+                               && move.getPosition() >= previousPosition;
+            if (run.midPosition < 0 && run.time >= move.getDuration() / 2) {
+                // planned position at exactly half the duration is half the distance, profile is symmetric
+                float overshoot = run.time - move.getDuration() / 2;
+                run.midPosition = move.getPosition() - move.getSpeed() * overshoot;
+            }
+            previousPosition = move.getPosition();
+            previousSpeed = move.getSpeed();
+        }
+        return run;
+    }
+
+    void testMove(float distance, float speed, float acceleration, float dt, bool irregular)
+    {
+        TrapezoidalMove move;
+        CHECK(move.start(distance, speed, acceleration));
+        // reaches cruise speed if accelerating to it takes at most half the distance
+        float peak = std::fmin(speed, std::sqrt(distance * acceleration));
+        float duration = peak < speed ? 2 * peak / acceleration : distance / speed + speed / acceleration;
+        CHECK_NEAR(move.getDuration(), duration, 1e-4f * duration);
+
+        Run run = runMove(move, speed, acceleration, dt, irregular);
+        std::printf("%6.1f mm at %4.1f mm/s, %4.1f mm/s^2, dt %.3f%s: %s, peak %.3f mm/s, end %.4f mm after %.3f s\n",
+                    distance, speed, acceleration, dt, irregular ? " irregular" : "",
+                    peak < speed ? "triangular" : "trapezoidal", run.peakSpeed, move.getPosition(), run.time);
+        CHECK(move.isFinished());
+        CHECK(move.getPosition() == distance);
+        CHECK(move.getSpeed() == 0.0f);
+        CHECK(run.withinLimits);
+        CHECK_NEAR(run.peakSpeed, peak, acceleration * 3 * dt);
+        CHECK(run.time >= duration && run.time < duration + 3 * dt + 1e-4f);
+        CHECK_NEAR(run.midPosition, distance / 2, 1e-3f * distance);
+    }
+}
+
+int main()
+{
+    // trapezoidal: cruise at speed
+    testMove(300.0f, 5.0f, 10.0f, 0.01f, false);
+    testMove(300.0f, 5.0f, 10.0f, 0.01f, true);
+    testMove(20.0f, 8.0f, 4.0f, 0.1f, false);
+    // triangular: too short to reach speed, peak sqrt(distance * acceleration)
+    testMove(2.0f, 5.0f, 10.0f, 0.01f, false);
+    testMove(2.0f, 5.0f, 10.0f, 0.001f, true);
+    // exactly at the boundary, accelerating to speed takes half the distance
+    testMove(2.5f, 5.0f, 10.0f, 0.01f, false);
+
+    // rejected moves, abort stops the profile where it is
+    TrapezoidalMove move;
+    CHECK(!move.start(0.0f, 5.0f, 10.0f));
+    CHECK(!move.start(10.0f, 0.0f, 10.0f));
+    CHECK(!move.start(10.0f, 5.0f, -1.0f));
+    CHECK(!move.isRunning());
+    CHECK(move.start(10.0f, 5.0f, 10.0f));
+    move.update(0.5f);
+    float position = move.getPosition();
+    move.abort();
+    move.update(0.5f);
+    CHECK(!move.isRunning() && move.getPosition() == position);
+    return hostTestResult();
+}